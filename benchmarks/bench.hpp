@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+/// Runtime benchmark harness for generated parsers.
+/// Each bench_<grammar>.cpp includes the generated parser source directly, so that
+/// the harness can read the parser's value stack and the AST node list after a run.
+namespace bench {
+
+/// @brief return the peak resident set size of this process so far, in KB
+/// 0 where the platform does not report it
+inline auto getPeakKB() -> size_t {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage ru{};
+    if(getrusage(RUSAGE_SELF, &ru) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    // macOS reports bytes, linux reports KB
+    return static_cast<size_t>(ru.ru_maxrss) / 1024; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+#else
+    return static_cast<size_t>(ru.ru_maxrss);
+#endif
+#else
+    return 0;
+#endif
+}
+
+/// @brief reads an in-memory input without copying it, as std::istringstream would
+struct MemoryBuffer : public std::streambuf {
+    inline explicit MemoryBuffer(std::string& s) {
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+        setg(s.data(), s.data(), s.data() + s.size());
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+    }
+};
+
+/// @brief wall time and peak memory of one phase of a run
+struct Phase {
+    std::string name;
+    double ms = 0;
+    size_t peakKB = 0;
+};
+
+/// @brief measurements of one run of a generated parser over one input
+struct Result {
+    size_t bytes = 0;
+
+    /// @brief symbols shifted by the parser, including epsilon and end markers
+    size_t tokens = 0;
+
+    size_t reductions = 0;
+    size_t astNodes = 0;
+    std::vector<Phase> phases;
+
+    inline auto ms(const std::string& name) const -> double {
+        for(const auto& p : phases) {
+            if(p.name == name) {
+                return p.ms;
+            }
+        }
+        return 0;
+    }
+};
+
+/// @brief returns @arg count per second, given the time in ms it took
+inline auto rate(const double& count, const double& ms) -> double {
+    if(ms <= 0) {
+        return 0;
+    }
+    return count * 1000 / ms; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+}
+
+/// @brief times a callable and records it as a phase of @arg result
+template<typename FnT>
+inline void timePhase(Result& result, const std::string& name, const FnT& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    result.phases.push_back(Phase{name, elapsed.count(), getPeakKB()});
+}
+
+/// @brief run one generated parser over @arg input
+/// The phases are:
+/// - parse: lexing and parsing, which run together since the lexer calls the parser
+/// - ast: Parser::leave(), which creates the AST from the parser's value stack
+/// - walk: the walker called by @arg walk
+template<typename ModuleT, typename WalkT>
+inline auto runOnce(std::string& input, const WalkT& walk) -> Result {
+    Result result;
+    result.bytes = input.size();
+
+    ModuleT ymodule("bench");
+    timePhase(result, "parse", [&ymodule, &input]() {
+        MemoryBuffer buf(input);
+        std::istream is(&buf);
+        ymodule.beginStream();
+        ymodule.readStream(is, "bench.in");
+    });
+
+    for(const auto& v : ymodule._impl->parser.values) {
+        if(v->childs.empty() == true) {
+            ++result.tokens;
+        }else{
+            ++result.reductions;
+        }
+    }
+
+    timePhase(result, "ast", [&ymodule]() {
+        ymodule.endStream();
+    });
+    result.astNodes = ymodule._impl->ast.astNodes.size();
+
+    timePhase(result, "walk", [&ymodule, &walk]() {
+        walk(ymodule);
+    });
+    return result;
+}
+
+/// @brief parse a size such as 4096, 512K, 16M or 1G
+inline auto parseSize(const std::string& s) -> size_t {
+    size_t mul = 1;
+    auto num = s;
+    if(num.empty() == false) {
+        switch(num.back()) {
+        case 'K':
+        case 'k':
+            mul = 1024; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            break;
+        case 'M':
+        case 'm':
+            mul = 1024 * 1024; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            break;
+        case 'G':
+        case 'g':
+            mul = 1024 * 1024 * 1024; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            break;
+        }
+        if(mul > 1) {
+            num.pop_back();
+        }
+    }
+    return std::stoull(num) * mul;
+}
+
+inline void printHeader(std::ostream& os) {
+    os << std::format("{:<8} {:>10} {:>12} {:>12} {:>12} {:>10} {:>8} {:>12} {:>12} {:>12} {:>10} {:>10} {:>10} {:>12}\n",
+        "grammar", "bytes", "tokens", "reductions", "ast-nodes",
+        "parse-ms", "MB/s", "tokens/s", "reduces/s",
+        "nodes/s", "ast-ms", "walk-ms", "gen-ms", "peak-rss(KB)"
+    );
+}
+
+inline void printResult(std::ostream& os, const std::string& name, const Result& r, const double& genms) {
+    auto parsems = r.ms("parse");
+    auto astms = r.ms("ast");
+    auto mb = static_cast<double>(r.bytes) / (1024 * 1024); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    size_t peakKB = 0;
+    for(const auto& p : r.phases) {
+        peakKB = std::max(peakKB, p.peakKB);
+    }
+    os << std::format("{:<8} {:>10} {:>12} {:>12} {:>12} {:>10.1f} {:>8.1f} {:>12.0f} {:>12.0f} {:>12.0f} {:>10.1f} {:>10.1f} {:>10.1f} {:>12}\n",
+        name, r.bytes, r.tokens, r.reductions, r.astNodes,
+        parsems, rate(mb, parsems), rate(static_cast<double>(r.tokens), parsems), rate(static_cast<double>(r.reductions), parsems),
+        rate(static_cast<double>(r.astNodes), astms), astms, r.ms("walk"), genms, peakKB
+    );
+    for(const auto& p : r.phases) {
+        os << std::format("    {:<8} {:>10.1f} ms {:>12} KB\n", p.name, p.ms, p.peakKB);
+    }
+}
+
+/// @brief append one CSV row per phase of @arg r to @arg csvname
+inline void writeCSV(const std::string& csvname, const std::string& name, const Result& r) {
+    bool exists = std::ifstream(csvname).good();
+    std::ofstream os(csvname, std::ios::app);
+    if(!os) {
+        throw std::runtime_error("unable to open csv file:" + csvname);
+    }
+    if(exists == false) {
+        os << "grammar,bytes,tokens,reductions,ast_nodes,phase,ms,peak_rss_kb\n";
+    }
+    for(const auto& p : r.phases) {
+        os << std::format("{},{},{},{},{},{},{:.3f},{}\n", name, r.bytes, r.tokens, r.reductions, r.astNodes, p.name, p.ms, p.peakKB);
+    }
+}
+
+inline int help(const std::string& xname, const std::string& msg) {
+    std::cout << std::format("== {} ==\n", msg);
+    std::cout << std::format("{} <options>\n", xname);
+    std::cout << "options:\n";
+    std::cout << "    -n <size>    : benchmark a synthetic input of <size> bytes, e.g. 1M, 64M, 1G (repeatable, default 1M)\n";
+    std::cout << "    -c <csvfile> : append the measurements to <csvfile>\n";
+    std::cout << "    -w <file>    : write the synthetic input of the last size to <file> and exit\n";
+    return 1;
+}
+
+/// @brief entry point shared by all bench_<grammar> executables
+/// @arg generate returns a synthetic input of about the requested size
+/// @arg walk invokes the grammar's walker on a parsed module
+template<typename ModuleT, typename WalkT>
+inline int run(
+    const std::string& name,
+    int argc,
+    char* argv[],
+    const std::function<std::string(const size_t&)>& generate,
+    const WalkT& walk
+) {
+    std::vector<size_t> sizes;
+    std::string csvname;
+    std::string wname;
+
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+    int i = 1;
+    while(i < argc) {
+        std::string a = argv[i];
+        if(a == "-n") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid size");
+            }
+            sizes.push_back(parseSize(argv[i]));
+        }else if(a == "-c") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid csv file");
+            }
+            csvname = argv[i];
+        }else if(a == "-w") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid input file");
+            }
+            wname = argv[i];
+        }else{
+            return help(argv[0], "unknown option:" + a);
+        }
+        ++i;
+    }
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+
+    if(sizes.empty() == true) {
+        sizes.push_back(parseSize("1M"));
+    }
+
+    if(wname.size() > 0) {
+        std::ofstream os(wname, std::ios::binary);
+        os << generate(sizes.back());
+        return 0;
+    }
+
+    for(const auto& size : sizes) {
+        std::string input;
+        auto start = std::chrono::steady_clock::now();
+        input = generate(size);
+        std::chrono::duration<double, std::milli> genms = std::chrono::steady_clock::now() - start;
+
+        auto result = runOnce<ModuleT>(input, walk);
+        printHeader(std::cout);
+        printResult(std::cout, name, result, genms.count());
+        if(csvname.size() > 0) {
+            writeCSV(csvname, name, result);
+        }
+    }
+    return 0;
+}
+} // namespace bench
@@ -0,0 +1,47 @@
+// runtime benchmark for the tutorial calculator grammar
+#include "calc_parser.cpp"
+#include "bench.hpp"
+#include <random>
+
+namespace {
+/// @brief the operands are small, and the operators alternate between + and - per level,
+/// so the result of the expression stays within an int even for 1G inputs
+inline void genExpr(std::string& s, std::minstd_rand& rng, const size_t& terms, const size_t& level) {
+    if(terms == 1) {
+        if((rng() % 4) == 0) {
+            auto a = (rng() % 3) + 1;
+            auto b = (rng() % 3) + 1;
+            s += std::format("{}*{}", a, b);
+        }else{
+            auto a = (rng() % 9) + 1; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            s += std::format("{}", a);
+        }
+        return;
+    }
+
+    // split into two halves, so that the AST, and the walker recursion, is log2(terms) deep
+    auto lhs = terms / 2;
+    s += "(";
+    genExpr(s, rng, lhs, level + 1);
+    s += ((level % 2) == 0) ? " + " : " - ";
+    genExpr(s, rng, terms - lhs, level + 1);
+    s += ")";
+}
+
+inline auto generate(const size_t& bytes) -> std::string {
+    std::minstd_rand rng(42); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+    // each term takes about 7 bytes including its operator and parentheses
+    auto terms = std::max<size_t>(bytes / 7, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    std::string s;
+    s.reserve(bytes + bytes / 4);
+    genExpr(s, rng, terms, 0);
+    return s;
+}
+}
+
+int main(int argc, char* argv[]) {
+    return bench::run<Calculator>("calc", argc, argv, generate, [](Calculator& ymodule) {
+        ymodule.walk_Calc();
+    });
+}
@@ -0,0 +1,120 @@
+// runtime benchmark for the expression-heavy language grammar
+#include "expr_parser.cpp"
+#include "bench.hpp"
+#include <random>
+
+namespace {
+/// @brief maximum number of statements in one block
+/// keeps the left-recursive statement lists, and so the walker recursion, shallow
+constexpr size_t fanout = 32;
+
+/// @brief depth of the binary operator tree in each statement
+constexpr size_t exprDepth = 3;
+
+const std::vector<std::string> ops = {"||", "&&", "==", "!=", "<", ">", "<=", ">=", "+", "-", "*", "/", "%"};
+const std::vector<std::string> ids = {"a", "b", "count", "total", "x1", "idx"};
+
+inline auto pick(std::minstd_rand& rng, const std::vector<std::string>& v) -> const std::string& {
+    return v.at(rng() % v.size());
+}
+
+/// @brief ycc does not yet parse two opening brackets back to back, so @arg open is
+/// false where the expression directly follows one
+inline void genExpr(std::string& s, std::minstd_rand& rng, const size_t& depth, const bool& open) {
+    if(depth == 0) {
+        switch(rng() % 6) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        case 0:
+            s += std::format("{}({}, {})", pick(rng, ids), pick(rng, ids), rng() % 100); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            break;
+        case 1:
+            s += "!" + pick(rng, ids);
+            break;
+        case 2:
+        case 3:
+            s += pick(rng, ids);
+            break;
+        default:
+            s += std::format("{}", rng() % 1000); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            break;
+        }
+        return;
+    }
+
+    bool paren = (open == true) && ((rng() % 4) == 0);
+    if(paren == true) {
+        s += "(";
+    }
+    genExpr(s, rng, depth - 1, (open == true) && (paren == false));
+    s += " " + pick(rng, ops) + " ";
+    genExpr(s, rng, depth - 1, true);
+    if(paren == true) {
+        s += ")";
+    }
+}
+
+inline void genStmt(std::string& s, std::minstd_rand& rng, const std::string& indent) {
+    s += indent;
+    switch(rng() % 3) {
+    case 0:
+        s += "let " + pick(rng, ids) + " = ";
+        break;
+    case 1:
+        s += pick(rng, ids) + " = ";
+        break;
+    default:
+        s += "return ";
+        break;
+    }
+    genExpr(s, rng, exprDepth, true);
+    s += ";\n";
+}
+
+inline void genBlock(std::string& s, std::minstd_rand& rng, const size_t& stmts, const std::string& indent) {
+    s += "{\n";
+    auto xindent = indent + "    ";
+    if(stmts <= fanout) {
+        for(size_t i = 0; i < stmts; ++i) {
+            genStmt(s, rng, xindent);
+        }
+    }else{
+        auto chunk = (stmts + fanout - 1) / fanout;
+        size_t done = 0;
+        while(done < stmts) {
+            auto n = std::min(chunk, stmts - done);
+            s += xindent;
+            switch(rng() % 2) {
+            case 0:
+                s += "if (";
+                genExpr(s, rng, 1, false);
+                s += ") ";
+                break;
+            default:
+                s += "while (";
+                genExpr(s, rng, 1, false);
+                s += ") ";
+                break;
+            }
+            genBlock(s, rng, n, xindent);
+            done += n;
+        }
+    }
+    s += indent + "}\n";
+}
+
+inline auto generate(const size_t& bytes) -> std::string {
+    std::minstd_rand rng(42); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+    // each statement takes about 85 bytes
+    auto stmts = std::max<size_t>(bytes / 85, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    std::string s;
+    s.reserve(bytes + bytes / 4);
+    genBlock(s, rng, stmts, "");
+    return s;
+}
+}
+
+int main(int argc, char* argv[]) {
+    return bench::run<Expr>("expr", argc, argv, generate, [](Expr& ymodule) {
+        ymodule.walk_Eval();
+    });
+}
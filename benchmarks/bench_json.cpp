@@ -0,0 +1,67 @@
+// runtime benchmark for the JSON grammar
+#include "json_parser.cpp"
+#include "bench.hpp"
+#include <random>
+
+namespace {
+/// @brief maximum number of values in one array
+/// keeps the left-recursive element lists, and so the walker recursion, shallow
+constexpr size_t fanout = 32;
+
+inline void genRecord(std::string& s, std::minstd_rand& rng, const size_t& id) {
+    static const std::vector<std::string> names = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta"};
+    auto name = names.at(rng() % names.size());
+    auto score = rng() % 100000; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    auto active = ((rng() % 2) == 0) ? "true" : "false";
+    s += std::format(R"({{"id": {}, "name": "{}-{}", "score": {}.{}, "active": {}, "tags": ["x", "y", "z"], "parent": null}})",
+        id, name, id, score / 100, score % 100, active // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    );
+}
+
+/// @brief nested arrays are wrapped in an object, as ycc does not yet parse two opening
+/// brackets back to back
+inline void genArray(std::string& s, std::minstd_rand& rng, const size_t& records, size_t& id) {
+    s += "[";
+    if(records <= fanout) {
+        for(size_t i = 0; i < records; ++i) {
+            if(i > 0) {
+                s += ",\n";
+            }
+            genRecord(s, rng, id);
+            ++id;
+        }
+    }else{
+        auto chunk = (records + fanout - 1) / fanout;
+        size_t done = 0;
+        while(done < records) {
+            if(done > 0) {
+                s += ",\n";
+            }
+            auto n = std::min(chunk, records - done);
+            s += std::format(R"({{"count": {}, "items": )", n);
+            genArray(s, rng, n, id);
+            s += "}";
+            done += n;
+        }
+    }
+    s += "]";
+}
+
+inline auto generate(const size_t& bytes) -> std::string {
+    std::minstd_rand rng(42); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+    // each record takes about 120 bytes
+    auto records = std::max<size_t>(bytes / 120, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    std::string s;
+    s.reserve(bytes + bytes / 4);
+    size_t id = 1;
+    genArray(s, rng, records, id);
+    return s;
+}
+}
+
+int main(int argc, char* argv[]) {
+    return bench::run<Json>("json", argc, argv, generate, [](Json& ymodule) {
+        ymodule.walk_Counter();
+    });
+}
@@ -0,0 +1,415 @@
+// scalability benchmark for ycc itself
+// synthesizes grammars of growing size, runs ycc with -j +timing on each,
+// and reports the time and peak memory of buildLexer, buildParser and generateGrammar against the number of rules
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/// @brief shape of one synthetic grammar
+struct Shape {
+    /// @brief number of statement rules
+    size_t rules = 0;
+
+    /// @brief number of keyword tokens, statement rules are prefixed by a unique pair of keywords
+    size_t tokens = 0;
+
+    /// @brief number of lexer modes besides the default mode
+    size_t modes = 0;
+
+    /// @brief number of precedence levels, one binary operator per level
+    size_t precedence = 0;
+
+    /// @brief number of tokens that match large Unicode classes
+    size_t unicode = 0;
+};
+
+/// @brief measurements of one ycc run
+struct Result {
+    Shape shape;
+    double totalms = 0;
+    std::vector<std::pair<std::string, double>> phaseMS;
+    std::map<std::string, size_t> phaseKB;
+    std::map<std::string, size_t> counts;
+
+    inline auto ms(const std::string& name) const -> double {
+        for(const auto& p : phaseMS) {
+            if(p.first == name) {
+                return p.second;
+            }
+        }
+        return 0;
+    }
+
+    inline auto kb(const std::string& name) const -> size_t {
+        auto it = phaseKB.find(name);
+        if(it == phaseKB.end()) {
+            return 0;
+        }
+        return it->second;
+    }
+};
+
+/// @brief phases reported, in order
+const std::vector<std::string> phaseNames = {"buildLexer", "buildParser", "generateGrammar"};
+
+/// @brief append code point @arg ch to @arg s as UTF-8
+inline void appendUtf8(std::string& s, const uint32_t& ch) {
+    // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    if(ch < 0x80) {
+        s += static_cast<char>(ch);
+    }else if(ch < 0x800) {
+        s += static_cast<char>(0xC0 | (ch >> 6));
+        s += static_cast<char>(0x80 | (ch & 0x3F));
+    }else{
+        s += static_cast<char>(0xE0 | (ch >> 12));
+        s += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (ch & 0x3F));
+    }
+    // NOLINTEND(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+}
+
+/// @brief return the text of a grammar of shape @arg shape
+/// The grammar is LALR(1) without conflicts:
+/// - each statement rule starts with its own pair of keywords
+/// - each expression operator has its own %left level
+/// - each lexer mode is entered by its own token and left by '>'
+/// - each Unicode token starts with its own code point, followed by a class of 32 disjoint ranges
+inline auto generateGrammar(const Shape& shape) -> std::string {
+    std::ostringstream os;
+    os << "%class Synth;\n\n";
+
+    os << "start := stmts;\n";
+    os << "stmts := stmts stmt;\n";
+    os << "stmts := stmt;\n";
+    for(size_t i = 0; i < shape.rules; ++i) {
+        os << std::format("stmt := r{};\n", i);
+    }
+    for(size_t i = 0; i < shape.modes; ++i) {
+        os << std::format("stmt := ENTER{} MTEXT{} LEAVE{};\n", i, i, i);
+    }
+    os << "\n";
+
+    for(size_t i = 0; i < shape.rules; ++i) {
+        auto a = i % shape.tokens;
+        auto b = (i / shape.tokens) % shape.tokens;
+        os << std::format("r{} := KW{} KW{} expr SEMI;\n", i, a, b);
+    }
+    os << "\n";
+
+    for(size_t i = 0; i < shape.precedence; ++i) {
+        os << std::format("expr := expr OP{} expr;\n", i);
+    }
+    os << "expr := LPAREN expr RPAREN;\n";
+    os << "expr := ID;\n";
+    os << "expr := NUMBER;\n";
+    for(size_t i = 0; i < shape.unicode; ++i) {
+        os << std::format("expr := U{};\n", i);
+    }
+    os << "\n";
+
+    for(size_t i = 0; i < shape.precedence; ++i) {
+        os << std::format("%left OP{};\n", i);
+    }
+    os << "\n";
+
+    for(size_t i = 0; i < shape.tokens; ++i) {
+        os << std::format("KW{} := \"kw{}\";\n", i, i);
+    }
+    for(size_t i = 0; i < shape.precedence; ++i) {
+        os << std::format("OP{} := \"op{}\";\n", i, i);
+    }
+    for(size_t i = 0; i < shape.unicode; ++i) {
+        std::string rx;
+        appendUtf8(rx, 0x0100 + static_cast<uint32_t>(i)); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        rx += "[";
+        for(uint32_t j = 0; j < 32; ++j) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            auto lo = 0x0400 + (j * 0x200) + static_cast<uint32_t>(i % 0x100); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            appendUtf8(rx, lo);
+            rx += "-";
+            appendUtf8(rx, lo + 0xFF); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+        rx += "]*";
+        os << std::format("U{} := \"{}\";\n", i, rx);
+    }
+    for(size_t i = 0; i < shape.modes; ++i) {
+        os << std::format("ENTER{} := \"<{}\" [m{}];\n", i, i, i);
+    }
+    os << "SEMI := \";\";\n";
+    os << "LPAREN := \"\\(\";\n";
+    os << "RPAREN := \"\\)\";\n";
+    os << "ID := \"[A-Z][A-Za-z]*\";\n";
+    os << "NUMBER := \"\\d+\";\n";
+    os << "WS := \"\\s\"!;\n";
+
+    for(size_t i = 0; i < shape.modes; ++i) {
+        os << std::format("\n%lexer_mode m{};\n", i);
+        os << std::format("MTEXT{} := \"[^>]+\";\n", i);
+        os << std::format("LEAVE{} := \">\" [^];\n", i);
+    }
+    return os.str();
+}
+
+/// @brief read the phases and counts from a file written by ycc -j +timing
+inline void readTiming(const std::filesystem::path& jname, Result& result) {
+    std::ifstream is(jname);
+    if(!is) {
+        throw std::runtime_error("unable to open timing file:" + jname.string());
+    }
+    std::stringstream ss;
+    ss << is.rdbuf();
+    auto text = ss.str();
+
+    static const std::regex rxPhase(R"x(\{"name": "([^"]+)", "ms": ([0-9.]+), "peak_rss_kb": ([0-9]+)\})x");
+    for(auto it = std::sregex_iterator(text.begin(), text.end(), rxPhase); it != std::sregex_iterator(); ++it) {
+        const auto& m = *it;
+        result.phaseMS.emplace_back(m[1].str(), std::stod(m[2].str()));
+        result.phaseKB[m[1].str()] = std::stoull(m[3].str());
+    }
+
+    auto cb = text.find("\"counts\"");
+    auto ce = text.find('}', cb);
+    if((cb == std::string::npos) || (ce == std::string::npos)) {
+        throw std::runtime_error("invalid timing file:" + jname.string());
+    }
+    auto counts = text.substr(cb, ce - cb);
+    static const std::regex rxCount(R"x("(\w+)": ([0-9]+))x");
+    for(auto it = std::sregex_iterator(counts.begin(), counts.end(), rxCount); it != std::sregex_iterator(); ++it) {
+        const auto& m = *it;
+        result.counts[m[1].str()] = std::stoull(m[2].str());
+    }
+}
+
+/// @brief generate a grammar of shape @arg shape in @arg wdir and run @arg ycc on it
+inline auto runOnce(const std::string& ycc, const std::filesystem::path& wdir, const Shape& shape) -> Result {
+    Result result;
+    result.shape = shape;
+
+    auto name = std::format("synth_{}", shape.rules);
+    auto gname = wdir / (name + ".yantra");
+    {
+        std::ofstream os(gname, std::ios::binary);
+        if(!os) {
+            throw std::runtime_error("unable to open grammar file:" + gname.string());
+        }
+        os << generateGrammar(shape);
+    }
+
+    auto cmd = std::format("\"{}\" -j +timing -d \"{}\" -n {} -f \"{}\"", ycc, wdir.string(), name, gname.string());
+    auto start = std::chrono::steady_clock::now();
+    auto rc = std::system(cmd.c_str()); // NOLINT(cert-env33-c,concurrency-mt-unsafe)
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if(rc != 0) {
+        throw std::runtime_error(std::format("ycc failed on {}, see {}.log", gname.string(), (wdir / name).string()));
+    }
+    result.totalms = elapsed.count();
+
+    readTiming(wdir / (name + ".timing.json"), result);
+    return result;
+}
+
+/// @brief return the shape for @arg rules statement rules
+/// Any value in @arg fixed that is non-zero is used as is, the others grow with the number of rules
+inline auto getShape(const size_t& rules, const Shape& fixed) -> Shape {
+    Shape shape;
+    shape.rules = rules;
+    shape.tokens = (fixed.tokens > 0) ? fixed.tokens : std::max<size_t>(rules, 1);
+    shape.modes = (fixed.modes > 0) ? fixed.modes : std::max<size_t>(rules / 32, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    shape.precedence = (fixed.precedence > 0) ? fixed.precedence : std::max<size_t>(rules / 8, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    shape.unicode = (fixed.unicode > 0) ? fixed.unicode : std::max<size_t>(rules / 16, 1); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+    // each rule needs its own pair of keywords
+    while((shape.tokens * shape.tokens) < shape.rules) {
+        ++shape.tokens;
+    }
+    return shape;
+}
+
+inline void printHeader(std::ostream& os) {
+    os << std::format("{:>6} {:>6} {:>5} {:>5} {:>5} {:>10} {:>10} {:>12} {:>12} {:>12} {:>16} {:>12} {:>12}\n",
+        "rules", "tokens", "modes", "prec", "ucls", "lx-states", "itemsets",
+        "lexer-ms", "parser-ms", "gen-ms", "peak-rss(KB)", "total-ms", "ms/rule"
+    );
+}
+
+inline void printResult(std::ostream& os, const Result& r) {
+    size_t peakKB = 0;
+    for(const auto& p : r.phaseKB) {
+        peakKB = std::max(peakKB, p.second);
+    }
+    double buildms = 0;
+    for(const auto& p : phaseNames) {
+        buildms += r.ms(p);
+    }
+    os << std::format("{:>6} {:>6} {:>5} {:>5} {:>5} {:>10} {:>10} {:>12.1f} {:>12.1f} {:>12.1f} {:>16} {:>12.1f} {:>12.3f}\n",
+        r.shape.rules, r.shape.tokens, r.shape.modes, r.shape.precedence, r.shape.unicode,
+        r.counts.contains("lexer_states") ? r.counts.at("lexer_states") : 0,
+        r.counts.contains("itemsets") ? r.counts.at("itemsets") : 0,
+        r.ms("buildLexer"), r.ms("buildParser"), r.ms("generateGrammar"),
+        peakKB, r.totalms, buildms / static_cast<double>(std::max<size_t>(r.shape.rules, 1))
+    );
+}
+
+/// @brief append one CSV row per phase of @arg r to @arg csvname
+inline void writeCSV(const std::string& csvname, const Result& r) {
+    bool exists = std::ifstream(csvname).good();
+    std::ofstream os(csvname, std::ios::app);
+    if(!os) {
+        throw std::runtime_error("unable to open csv file:" + csvname);
+    }
+    if(exists == false) {
+        os << "rules,tokens,modes,precedence,unicode,lexer_states,itemsets,phase,ms,peak_rss_kb\n";
+    }
+    for(const auto& p : phaseNames) {
+        os << std::format("{},{},{},{},{},{},{},{},{:.3f},{}\n",
+            r.shape.rules, r.shape.tokens, r.shape.modes, r.shape.precedence, r.shape.unicode,
+            r.counts.contains("lexer_states") ? r.counts.at("lexer_states") : 0,
+            r.counts.contains("itemsets") ? r.counts.at("itemsets") : 0,
+            p, r.ms(p), r.kb(p)
+        );
+    }
+}
+
+/// @brief write a gnuplot script that plots @arg csvname, time and memory against the number of rules
+inline void writePlot(const std::string& pname, const std::string& csvname) {
+    std::ofstream os(pname);
+    if(!os) {
+        throw std::runtime_error("unable to open plot file:" + pname);
+    }
+    os << "# gnuplot script written by bench_ycc\n";
+    os << "set datafile separator ','\n";
+    os << "set terminal pngcairo size 1200,500\n";
+    os << std::format("set output '{}.png'\n", csvname);
+    os << "set key left top\n";
+    os << "set xlabel 'rules'\n";
+    os << "set multiplot layout 1,2\n";
+    os << "set ylabel 'ms'\n";
+    os << "set title 'time'\n";
+    std::string sep = "plot ";
+    for(const auto& p : phaseNames) {
+        os << std::format("{}'{}' using 1:(strcol(8) eq '{}' ? $9 : 1/0) with linespoints title '{}'", sep, csvname, p, p);
+        sep = ", \\\n     ";
+    }
+    os << "\n";
+    os << "set ylabel 'KB'\n";
+    os << "set title 'peak memory'\n";
+    os << std::format("plot '{}' using 1:(strcol(8) eq 'generateGrammar' ? $10 : 1/0) with linespoints title 'peak-rss'\n", csvname);
+    os << "unset multiplot\n";
+}
+
+inline int help(const std::string& xname, const std::string& msg) {
+    std::cout << std::format("== {} ==\n", msg);
+    std::cout << std::format("{} <options>\n", xname);
+    std::cout << "options:\n";
+    std::cout << "    -y <ycc>      : path to ycc\n";
+    std::cout << "    -r <rules>    : benchmark a grammar with <rules> statement rules (repeatable, default 25 50 100 200 400)\n";
+    std::cout << "    -t <tokens>   : use <tokens> keyword tokens (default: one per rule)\n";
+    std::cout << "    -k <modes>    : use <modes> lexer modes (default: one per 32 rules)\n";
+    std::cout << "    -p <levels>   : use <levels> precedence levels (default: one per 8 rules)\n";
+    std::cout << "    -u <classes>  : use <classes> Unicode class tokens (default: one per 16 rules)\n";
+    std::cout << "    -d <dir>      : directory for the synthetic grammars and ycc output (default: ycc_bench)\n";
+    std::cout << "    -c <csvfile>  : append the measurements to <csvfile>\n";
+    std::cout << "    -g <plotfile> : write a gnuplot script that plots <csvfile> to <plotfile>\n";
+    std::cout << "    -w <file>     : write the grammar for the last -r to <file> and exit\n";
+    return 1;
+}
+}
+
+int main(int argc, char* argv[]) {
+#if defined(YCC_PATH)
+    std::string ycc = YCC_PATH;
+#else
+    std::string ycc = "ycc";
+#endif
+    std::vector<size_t> sizes;
+    Shape fixed;
+    std::string wdir = "ycc_bench";
+    std::string csvname;
+    std::string pname;
+    std::string wname;
+
+    try {
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+        int i = 1;
+        while(i < argc) {
+            std::string a = argv[i];
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "missing value for option:" + a);
+            }
+            std::string v = argv[i];
+            if(a == "-y") {
+                ycc = v;
+            }else if(a == "-r") {
+                sizes.push_back(std::stoull(v));
+            }else if(a == "-t") {
+                fixed.tokens = std::stoull(v);
+            }else if(a == "-k") {
+                fixed.modes = std::stoull(v);
+            }else if(a == "-p") {
+                fixed.precedence = std::stoull(v);
+            }else if(a == "-u") {
+                fixed.unicode = std::stoull(v);
+            }else if(a == "-d") {
+                wdir = v;
+            }else if(a == "-c") {
+                csvname = v;
+            }else if(a == "-g") {
+                pname = v;
+            }else if(a == "-w") {
+                wname = v;
+            }else{
+                return help(argv[0], "unknown option:" + a);
+            }
+            ++i;
+        }
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+
+        if(sizes.empty() == true) {
+            sizes = {25, 50, 100, 200, 400}; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+
+        if(wname.size() > 0) {
+            std::ofstream os(wname, std::ios::binary);
+            os << generateGrammar(getShape(sizes.back(), fixed));
+            return 0;
+        }
+
+        std::filesystem::create_directories(wdir);
+        printHeader(std::cout);
+        for(const auto& rules : sizes) {
+            auto result = runOnce(ycc, wdir, getShape(rules, fixed));
+            printResult(std::cout, result);
+            if(csvname.size() > 0) {
+                writeCSV(csvname, result);
+            }
+        }
+
+        if(pname.size() > 0) {
+            if(csvname.empty() == true) {
+                return help(argv[0], "-g needs -c");
+            }
+            writePlot(pname, csvname);
+        }
+    }catch(const std::exception& ex) {
+        std::cout << std::format("error:{}\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
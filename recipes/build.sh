@@ -65,3 +65,13 @@ if [ "$routput" == "a = a.b" ]; then
 else
     echo "FAIL"
 fi
+
+./bin/ycc -f ../../recipes/inline-separate/grammar.y -u
+clang++ -g -Wall --std=c++20 -I . grammar.cpp grammar_ast.cpp grammar_parser.cpp grammar_lexer.cpp grammar_walker_Compiler.cpp ../../recipes/inline-separate/main.cpp
+echo -n "run inline-separate:split(2 + 1 * 3)..."
+routput=$(./a.out "2 + 1 * 3")
+if [ "$routput" == "Result(inline-separate): 5" ]; then
+    echo "PASS"
+else
+    echo "FAIL"
+fi
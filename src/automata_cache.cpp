@@ -0,0 +1,879 @@
+#include "pch.hpp"
+#include "automata_cache.hpp"
+#include "lexer_builder.hpp"
+#include "parser_builder.hpp"
+#include "logger.hpp"
+#include "timing.hpp"
+#include "config.hpp"
+
+namespace {
+/// @brief layout version of the cache file
+/// bump this whenever the layout of the file, or the way the automata are built, changes
+constexpr size_t CacheVersion = 1;
+
+/// @brief tag at the start of every cache file
+constexpr const char* const CacheTag = "ycc-automata";
+
+/// @brief FNV-1a hash over the structural parts of a grammar
+/// Only the parts that feed buildLexer() and buildParser() are hashed, so that
+/// editing a codeblock, a walker or a file position does not invalidate the cache
+struct StructureHash {
+    uint64_t value = 0xcbf29ce484222325ULL; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+
+    inline void add(const std::string_view& s) {
+        for(const auto& ch : s) {
+            mix(static_cast<uint8_t>(ch));
+        }
+        // terminate every field, so that ("ab", "c") and ("a", "bc") differ
+        mix(0xFFU); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    }
+
+    inline void add(const size_t& n) {
+        add(std::to_string(n));
+    }
+
+    inline auto str() const -> std::string {
+        return std::format("{:016x}", value);
+    }
+
+private:
+    inline void mix(const uint8_t& b) {
+        value ^= b;
+        value *= 0x100000001b3ULL; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+    }
+};
+
+/// @brief lists all the atoms of all the regexes in a fixed order
+/// Transitions and States refer to atoms by reference. The cache stores the
+/// position of the atom in this list instead, which is the same for any two
+/// grammars with the same structure hash.
+struct AtomIndex {
+    std::vector<const yglx::Atom*> atoms;
+    std::unordered_map<const void*, size_t> index;
+
+    explicit inline AtomIndex(const yg::Grammar& g) {
+        for(const auto& regex : g.regexes) {
+            if(regex->atom) {
+                add(*(regex->atom));
+            }
+        }
+    }
+
+    inline void add(const yglx::Atom& a) {
+        const auto* key = std::visit([](const auto& x) -> const void* {return &x;}, a.atom);
+        atoms.push_back(&a);
+        index[key] = atoms.size();
+        std::visit(*this, a.atom);
+    }
+
+    inline void operator()(const yglx::Primitive&) {}
+    inline void operator()(const yglx::Class&) {}
+
+    inline void operator()(const yglx::Sequence& a) {
+        add(*(a.lhs));
+        add(*(a.rhs));
+    }
+
+    inline void operator()(const yglx::Disjunct& a) {
+        add(*(a.lhs));
+        add(*(a.rhs));
+    }
+
+    inline void operator()(const yglx::Group& a) {
+        add(*(a.atom));
+    }
+
+    inline void operator()(const yglx::Closure& a) {
+        add(*(a.atom));
+    }
+
+    inline auto getId(const void* a) const -> size_t {
+        if(auto it = index.find(a); it != index.end()) {
+            return it->second;
+        }
+        return 0;
+    }
+
+    template<typename AtomT>
+    inline auto get(const size_t& id) const -> const AtomT* {
+        if((id == 0) || (id > atoms.size())) {
+            return nullptr;
+        }
+        return std::get_if<AtomT>(&(atoms.at(id - 1)->atom));
+    }
+};
+
+/// @brief adds a regex atom tree to a StructureHash
+struct AtomHasher {
+    StructureHash& h;
+
+    explicit inline AtomHasher(StructureHash& x) : h(x) {}
+
+    inline void operator()(const yglx::WildCard&) {
+        h.add("W");
+    }
+
+    inline void operator()(const yglx::LargeEscClass& a) {
+        h.add("E");
+        h.add(a.checker);
+    }
+
+    inline void operator()(const yglx::RangeClass& a) {
+        h.add("R");
+        h.add(a.ch1);
+        h.add(a.ch2);
+    }
+
+    inline void operator()(const yglx::Primitive& a) {
+        h.add("P");
+        std::visit(*this, a.atom);
+    }
+
+    inline void operator()(const yglx::Class& a) {
+        h.add("C");
+        h.add(a.negate);
+        h.add(a.atoms.size());
+        for(const auto& ca : a.atoms) {
+            std::visit(*this, ca);
+        }
+    }
+
+    inline void operator()(const yglx::Sequence& a) {
+        h.add("S");
+        process(*(a.lhs));
+        process(*(a.rhs));
+    }
+
+    inline void operator()(const yglx::Disjunct& a) {
+        h.add("D");
+        process(*(a.lhs));
+        process(*(a.rhs));
+    }
+
+    inline void operator()(const yglx::Group& a) {
+        h.add("G");
+        h.add(a.capture);
+        process(*(a.atom));
+    }
+
+    inline void operator()(const yglx::Closure& a) {
+        h.add("K");
+        h.add(a.min);
+        h.add(a.max);
+        process(*(a.atom));
+    }
+
+    inline void process(const yglx::Atom& a) {
+        std::visit(*this, a.atom);
+    }
+};
+
+/// @brief return the structure hash of @arg g, as parsed and before the automata are built
+inline auto getStructureHash(const yg::Grammar& g) -> std::string {
+    StructureHash h;
+    h.add(YANTRA_VERSION_STRING);
+    h.add(CacheVersion);
+
+    h.add(g.start);
+    h.add(g.end);
+    h.add(g.empty);
+    h.add(g.unicodeEnabled);
+    h.add(g.autoResolve);
+    h.add(g.maxRepCount);
+    h.add(g.states.size());
+
+    std::vector<std::string> modeNames;
+    for(const auto& lm : g.lexerModes) {
+        modeNames.push_back(lm.first);
+    }
+    std::ranges::sort(modeNames);
+    for(const auto& name : modeNames) {
+        const auto& mode = *(g.lexerModes.at(name));
+        h.add(name);
+        h.add(zid(mode.root));
+        std::vector<std::string> includes(mode.includes.begin(), mode.includes.end());
+        std::ranges::sort(includes);
+        h.add(includes.size());
+        for(const auto& inc : includes) {
+            h.add(inc);
+        }
+    }
+
+    h.add(g.regexSets.size());
+    for(const auto& rx : g.regexSets) {
+        h.add(rx->name);
+        h.add(rx->precedence);
+        h.add(static_cast<size_t>(rx->assoc));
+        h.add(rx->regexes.size());
+        h.add(rx->fallbacks.size());
+        for(const auto& fb : rx->fallbacks) {
+            h.add(fb->name);
+        }
+    }
+
+    h.add(g.regexes.size());
+    for(const auto& regex : g.regexes) {
+        h.add(regex->regexName);
+        h.add(regex->mode);
+        h.add(static_cast<size_t>(regex->modeChange));
+        h.add(regex->nextMode);
+        if(regex->atom) {
+            AtomHasher ah(h);
+            ah.process(*(regex->atom));
+        }else{
+            h.add("-");
+        }
+    }
+
+    h.add(g.ruleSets.size());
+    for(const auto& rs : g.ruleSets) {
+        h.add(rs->name);
+        h.add(rs->hasEpsilon);
+        h.add(rs->rules.size());
+    }
+
+    h.add(g.rules.size());
+    for(const auto& rule : g.rules) {
+        h.add(rule->ruleSetName());
+        h.add(rule->ruleName);
+        h.add(rule->id);
+        h.add(rule->anchor);
+        h.add((rule->precedence != nullptr) ? rule->precedence->name : "");
+        h.add(rule->nodes.size());
+        for(const auto& node : rule->nodes) {
+            h.add(static_cast<size_t>(node->type));
+            h.add(node->name);
+        }
+    }
+    return h.str();
+}
+
+/// @brief lexer State, with all references replaced by 1-based positions (0 = null)
+struct StateData {
+    size_t row = 0;
+    size_t col = 0;
+    bool isRoot = false;
+    bool checkEOF = false;
+    size_t matchedRegex = 0;
+    size_t closure = 0;
+    size_t closureState = 0;
+    size_t enterClosureTransition = 0;
+    size_t leaveClosureTransition = 0;
+    size_t checkClosureTransition = 0;
+    size_t startClosureTransition = 0;
+    std::vector<size_t> transitions;
+    std::vector<size_t> superTransitions;
+    std::vector<size_t> shadowTransitions;
+};
+
+/// @brief kind of a lexer Transition, in the order of yglx::Transition_t
+enum class TransitionKind : uint8_t {
+    Primitive,
+    Class,
+    Closure,
+    Slide,
+};
+
+/// @brief lexer Transition, with all references replaced by 1-based positions (0 = null)
+struct TransitionData {
+    TransitionKind kind = TransitionKind::Slide;
+    size_t atom = 0;
+    size_t type = 0;
+    size_t initialCount = 0;
+    size_t from = 0;
+    size_t next = 0;
+    bool capture = true;
+};
+
+/// @brief parser ItemSet, with all references replaced by 1-based positions
+struct ItemSetData {
+    struct Shift {
+        size_t regexSet = 0;
+        size_t next = 0;
+        std::vector<size_t> epsilons;
+    };
+
+    struct Reduce {
+        size_t regexSet = 0;
+        size_t config = 0;
+        size_t len = 0;
+    };
+
+    struct Goto {
+        size_t ruleSet = 0;
+        size_t next = 0;
+    };
+
+    std::vector<size_t> configs;
+    std::vector<Shift> shifts;
+    std::vector<Reduce> reduces;
+    std::vector<Goto> gotos;
+};
+
+/// @brief the complete contents of a cache file
+struct CacheData {
+    std::vector<size_t> precedences;
+    std::vector<std::vector<size_t>> firsts;
+    std::vector<std::vector<size_t>> follows;
+    std::vector<StateData> states;
+    std::vector<TransitionData> transitions;
+    std::vector<std::pair<size_t, size_t>> configs;
+    std::vector<ItemSetData> itemSets;
+    size_t initialState = 0;
+};
+
+/// @brief reads the cache file, validating every value as it goes
+/// A file that does not match the grammar is reported as an INVALID_CACHE error
+struct Reader {
+    std::istream& is;
+    const FilePos pos;
+
+    inline Reader(std::istream& i, const FilePos& p) : is(i), pos(p) {}
+
+    [[noreturn]] inline void fail(const std::string_view& what) const {
+        throw GeneratorError(__LINE__, __FILE__, pos, "INVALID_CACHE:{}", what);
+    }
+
+    inline void expect(const std::string_view& tag) {
+        std::string s;
+        if(!(is >> s) || (s != tag)) {
+            fail(tag);
+        }
+    }
+
+    /// @brief read a number in the range [0, limit]
+    inline auto num(const size_t& limit = std::numeric_limits<size_t>::max()) -> size_t {
+        size_t n = 0;
+        if(!(is >> n) || (n > limit)) {
+            fail("number");
+        }
+        return n;
+    }
+
+    /// @brief read a reference in the range [1, limit]
+    inline auto ref(const size_t& limit) -> size_t {
+        auto n = num(limit);
+        if(n == 0) {
+            fail("reference");
+        }
+        return n;
+    }
+
+    inline auto flag() -> bool {
+        return num(1) == 1;
+    }
+
+    /// @brief read a counted list of references in the range [1, limit]
+    inline auto refs(const size_t& limit) -> std::vector<size_t> {
+        std::vector<size_t> list;
+        auto n = num();
+        for(size_t i = 0; i < n; ++i) {
+            list.push_back(ref(limit));
+        }
+        return list;
+    }
+
+    /// @brief read a section header, and return the number of entries in it
+    inline auto section(const std::string_view& name) -> size_t {
+        expect(name);
+        return num();
+    }
+};
+
+inline void readLexer(Reader& rd, CacheData& cd, const yg::Grammar& g, const AtomIndex& atoms) {
+    auto tcount = rd.section("transitions");
+    auto scount = rd.section("states");
+    if(scount < g.states.size()) {
+        rd.fail("states");
+    }
+
+    for(size_t i = 0; i < tcount; ++i) {
+        TransitionData td;
+        td.kind = static_cast<TransitionKind>(rd.num(static_cast<size_t>(TransitionKind::Slide)));
+        td.atom = rd.num(atoms.atoms.size());
+        td.type = rd.num(static_cast<size_t>(yglx::ClosureTransition::Type::Leave));
+        td.initialCount = rd.num();
+        td.from = rd.num(scount);
+        td.next = rd.num(scount);
+        td.capture = rd.flag();
+
+        bool valid = true;
+        switch(td.kind) {
+        case TransitionKind::Primitive:
+            valid = (atoms.get<yglx::Primitive>(td.atom) != nullptr);
+            break;
+        case TransitionKind::Class:
+            valid = (atoms.get<yglx::Class>(td.atom) != nullptr);
+            break;
+        case TransitionKind::Closure:
+            valid = (atoms.get<yglx::Closure>(td.atom) != nullptr);
+            break;
+        case TransitionKind::Slide:
+            break;
+        }
+        if(valid == false) {
+            rd.fail("atom");
+        }
+        cd.transitions.push_back(td);
+    }
+
+    for(size_t i = 0; i < scount; ++i) {
+        StateData sd;
+        sd.row = rd.num();
+        sd.col = rd.num();
+        sd.isRoot = rd.flag();
+        sd.checkEOF = rd.flag();
+        sd.matchedRegex = rd.num(g.regexes.size());
+        sd.closure = rd.num(atoms.atoms.size());
+        if((sd.closure != 0) && (atoms.get<yglx::Closure>(sd.closure) == nullptr)) {
+            rd.fail("closure");
+        }
+        sd.closureState = rd.num(scount);
+        sd.enterClosureTransition = rd.num(tcount);
+        sd.leaveClosureTransition = rd.num(tcount);
+        sd.checkClosureTransition = rd.num(tcount);
+        sd.startClosureTransition = rd.num(tcount);
+        sd.transitions = rd.refs(tcount);
+        sd.superTransitions = rd.refs(tcount);
+        sd.shadowTransitions = rd.refs(tcount);
+        cd.states.push_back(std::move(sd));
+    }
+}
+
+inline void readParser(Reader& rd, CacheData& cd, const yg::Grammar& g) {
+    if(rd.section("rules") != g.rules.size()) {
+        rd.fail("rules");
+    }
+    for(size_t i = 0; i < g.rules.size(); ++i) {
+        cd.precedences.push_back(rd.num(g.regexSets.size()));
+    }
+
+    if(rd.section("rulesets") != g.ruleSets.size()) {
+        rd.fail("rulesets");
+    }
+    for(size_t i = 0; i < g.ruleSets.size(); ++i) {
+        cd.firsts.push_back(rd.refs(g.regexSets.size()));
+        cd.follows.push_back(rd.refs(g.regexSets.size()));
+    }
+
+    auto ccount = rd.section("configs");
+    std::set<std::pair<size_t, size_t>> seen;
+    for(size_t i = 0; i < ccount; ++i) {
+        auto rule = rd.ref(g.rules.size());
+        auto cpos = rd.num(g.rules.at(rule - 1)->nodes.size());
+        if(seen.insert({rule, cpos}).second == false) {
+            rd.fail("config");
+        }
+        cd.configs.emplace_back(rule, cpos);
+    }
+
+    auto icount = rd.section("itemsets");
+    for(size_t i = 0; i < icount; ++i) {
+        ItemSetData isd;
+        isd.configs = rd.refs(ccount);
+
+        auto n = rd.num();
+        for(size_t j = 0; j < n; ++j) {
+            ItemSetData::Shift s;
+            s.regexSet = rd.ref(g.regexSets.size());
+            s.next = rd.ref(icount);
+            s.epsilons = rd.refs(g.ruleSets.size());
+            isd.shifts.push_back(std::move(s));
+        }
+
+        n = rd.num();
+        for(size_t j = 0; j < n; ++j) {
+            ItemSetData::Reduce r;
+            r.regexSet = rd.ref(g.regexSets.size());
+            r.config = rd.ref(ccount);
+            r.len = rd.num();
+            isd.reduces.push_back(r);
+        }
+
+        n = rd.num();
+        for(size_t j = 0; j < n; ++j) {
+            ItemSetData::Goto gt;
+            gt.ruleSet = rd.ref(g.ruleSets.size());
+            gt.next = rd.ref(icount);
+            isd.gotos.push_back(gt);
+        }
+        cd.itemSets.push_back(std::move(isd));
+    }
+
+    rd.expect("initial");
+    cd.initialState = rd.ref(icount);
+    rd.expect("end");
+}
+
+inline auto getPtr(const std::vector<std::unique_ptr<yglx::Transition>>& list, const size_t& id) -> yglx::Transition* {
+    if(id == 0) {
+        return nullptr;
+    }
+    return list.at(id - 1).get();
+}
+
+inline void applyLexer(yg::Grammar& g, const CacheData& cd, const AtomIndex& atoms) {
+    auto fpos = g.pos();
+    std::vector<yglx::State*> states;
+    for(size_t i = 0; i < cd.states.size(); ++i) {
+        auto& sd = cd.states.at(i);
+        yglx::State* s = nullptr;
+        if(i < g.states.size()) {
+            s = g.states.at(i).get();
+        }else{
+            FilePos p = fpos;
+            p.row = sd.row;
+            p.col = sd.col;
+            s = g.createNewState(p);
+        }
+        assert(s->id == (i + 1));
+        states.push_back(s);
+    }
+
+    auto getState = [&states](const size_t& id) -> yglx::State* {
+        if(id == 0) {
+            return nullptr;
+        }
+        return states.at(id - 1);
+    };
+
+    for(const auto& td : cd.transitions) {
+        auto* from = getState(td.from);
+        auto* next = getState(td.next);
+        std::unique_ptr<yglx::Transition> t;
+        switch(td.kind) {
+        case TransitionKind::Primitive:
+            t = std::make_unique<yglx::Transition>(yglx::PrimitiveTransition(*(atoms.get<yglx::Primitive>(td.atom))), from, next, td.capture);
+            break;
+        case TransitionKind::Class:
+            t = std::make_unique<yglx::Transition>(yglx::ClassTransition(*(atoms.get<yglx::Class>(td.atom))), from, next, td.capture);
+            break;
+        case TransitionKind::Closure: {
+            auto type = static_cast<yglx::ClosureTransition::Type>(td.type);
+            t = std::make_unique<yglx::Transition>(yglx::ClosureTransition(g, *(atoms.get<yglx::Closure>(td.atom)), type, td.initialCount), from, next, td.capture);
+            break;
+        }
+        case TransitionKind::Slide:
+            t = std::make_unique<yglx::Transition>(yglx::SlideTransition(), from, next, td.capture);
+            break;
+        }
+        g.transitions.push_back(std::move(t));
+    }
+
+    for(size_t i = 0; i < cd.states.size(); ++i) {
+        auto& sd = cd.states.at(i);
+        auto& s = *(states.at(i));
+        s.isRoot = sd.isRoot;
+        s.checkEOF = sd.checkEOF;
+        s.matchedRegex = (sd.matchedRegex == 0) ? nullptr : g.regexes.at(sd.matchedRegex - 1).get();
+        s.closure = atoms.get<yglx::Closure>(sd.closure);
+        s.closureState = getState(sd.closureState);
+        s.enterClosureTransition = getPtr(g.transitions, sd.enterClosureTransition);
+        s.leaveClosureTransition = getPtr(g.transitions, sd.leaveClosureTransition);
+        s.checkClosureTransition = getPtr(g.transitions, sd.checkClosureTransition);
+        s.startClosureTransition = getPtr(g.transitions, sd.startClosureTransition);
+        for(const auto& t : sd.transitions) {
+            s.transitions.push_back(getPtr(g.transitions, t));
+        }
+        for(const auto& t : sd.superTransitions) {
+            s.superTransitions.push_back(getPtr(g.transitions, t));
+        }
+        for(const auto& t : sd.shadowTransitions) {
+            s.shadowTransitions.push_back(getPtr(g.transitions, t));
+        }
+    }
+}
+
+inline void applyParser(yg::Grammar& g, const CacheData& cd) {
+    for(size_t i = 0; i < g.rules.size(); ++i) {
+        auto p = cd.precedences.at(i);
+        g.rules.at(i)->precedence = (p == 0) ? nullptr : g.regexSets.at(p - 1).get();
+    }
+
+    for(size_t i = 0; i < g.ruleSets.size(); ++i) {
+        auto& rs = *(g.ruleSets.at(i));
+        rs.firsts.clear();
+        for(const auto& rx : cd.firsts.at(i)) {
+            rs.firsts.push_back(g.regexSets.at(rx - 1).get());
+        }
+        rs.follows.clear();
+        for(const auto& rx : cd.follows.at(i)) {
+            rs.follows.push_back(g.regexSets.at(rx - 1).get());
+        }
+    }
+
+    for(const auto& c : cd.configs) {
+        [[maybe_unused]] auto& cfg = g.createConfig(*(g.rules.at(c.first - 1)), c.second);
+        assert(cfg.id == g.configs.size());
+    }
+
+    for(const auto& isd : cd.itemSets) {
+        std::vector<const ygp::Config*> configs;
+        for(const auto& c : isd.configs) {
+            configs.push_back(g.configs.at(c - 1).get());
+        }
+        g.createItemSet(configs);
+    }
+
+    for(size_t i = 0; i < cd.itemSets.size(); ++i) {
+        auto& isd = cd.itemSets.at(i);
+        auto& is = *(g.itemSets.at(i));
+
+        for(const auto& sd : isd.shifts) {
+            auto& s = is.shifts[g.regexSets.at(sd.regexSet - 1).get()];
+            s.next = g.itemSets.at(sd.next - 1).get();
+            for(const auto& e : sd.epsilons) {
+                s.epsilons.push_back(g.ruleSets.at(e - 1).get());
+            }
+        }
+        for(const auto& rd : isd.reduces) {
+            auto& r = is.reduces[g.regexSets.at(rd.regexSet - 1).get()];
+            r.next = g.configs.at(rd.config - 1).get();
+            r.len = rd.len;
+        }
+        for(const auto& gd : isd.gotos) {
+            is.gotos[g.ruleSets.at(gd.ruleSet - 1).get()] = g.itemSets.at(gd.next - 1).get();
+        }
+    }
+
+    g.initialState = g.itemSets.at(cd.initialState - 1).get();
+}
+
+/// @brief return the 1-based positions of all elements in @arg list
+template<typename T>
+inline auto getIndex(const std::vector<std::unique_ptr<T>>& list) -> std::unordered_map<const T*, size_t> {
+    std::unordered_map<const T*, size_t> index;
+    for(size_t i = 0; i < list.size(); ++i) {
+        index[list.at(i).get()] = i + 1;
+    }
+    return index;
+}
+
+/// @brief return the 1-based position of @arg t in @arg index, or 0 if @arg t is null
+template<typename T>
+inline auto getId(const std::unordered_map<const T*, size_t>& index, const T* t) -> size_t {
+    if(t == nullptr) {
+        return 0;
+    }
+    return index.at(t);
+}
+
+/// @brief return true if the id of every element in @arg list is its 1-based position
+/// The cache relies on this to restore the same ids the generator emits
+template<typename T>
+inline auto hasDenseIds(const std::vector<std::unique_ptr<T>>& list) -> bool {
+    for(size_t i = 0; i < list.size(); ++i) {
+        if(list.at(i)->id != (i + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void writeList(std::ostream& os, const std::vector<size_t>& list) {
+    std::print(os, " {}", list.size());
+    for(const auto& id : list) {
+        std::print(os, " {}", id);
+    }
+}
+
+inline void writeLexer(std::ostream& os, const yg::Grammar& g, const AtomIndex& atoms) {
+    auto tindex = getIndex(g.transitions);
+    auto rindex = getIndex(g.regexes);
+
+    auto getTxList = [&tindex](const std::vector<yglx::Transition*>& txs) -> std::vector<size_t> {
+        std::vector<size_t> list;
+        for(const auto& t : txs) {
+            list.push_back(tindex.at(t));
+        }
+        return list;
+    };
+
+    std::println(os, "transitions {}", g.transitions.size());
+    std::println(os, "states {}", g.states.size());
+    for(const auto& t : g.transitions) {
+        auto kind = static_cast<TransitionKind>(t->t.index());
+        size_t atom = 0;
+        size_t type = 0;
+        size_t initialCount = 0;
+        if(const auto* pt = std::get_if<yglx::PrimitiveTransition>(&(t->t))) {
+            atom = atoms.getId(&(pt->atom));
+        }else if(const auto* ct = std::get_if<yglx::ClassTransition>(&(t->t))) {
+            atom = atoms.getId(&(ct->atom));
+        }else if(const auto* xt = std::get_if<yglx::ClosureTransition>(&(t->t))) {
+            atom = atoms.getId(&(xt->atom));
+            type = static_cast<size_t>(xt->type);
+            initialCount = xt->initialCount;
+        }
+        assert((kind == TransitionKind::Slide) || (atom != 0));
+        std::println(os, "{} {} {} {} {} {} {}", static_cast<size_t>(kind), atom, type, initialCount, zid(t->from), zid(t->next), t->capture ? 1 : 0);
+    }
+
+    for(const auto& ps : g.states) {
+        const auto& s = *ps;
+        std::print(os, "{} {} {} {} {} {} {} {} {} {} {}",
+            s.pos.row,
+            s.pos.col,
+            s.isRoot ? 1 : 0,
+            s.checkEOF ? 1 : 0,
+            getId<yglx::Regex>(rindex, s.matchedRegex),
+            atoms.getId(s.closure),
+            zid(s.closureState),
+            getId<yglx::Transition>(tindex, s.enterClosureTransition),
+            getId<yglx::Transition>(tindex, s.leaveClosureTransition),
+            getId<yglx::Transition>(tindex, s.checkClosureTransition),
+            getId<yglx::Transition>(tindex, s.startClosureTransition)
+        );
+        writeList(os, getTxList(s.transitions));
+        writeList(os, getTxList(s.superTransitions));
+        writeList(os, getTxList(s.shadowTransitions));
+        std::println(os, "");
+    }
+}
+
+inline void writeParser(std::ostream& os, const yg::Grammar& g) {
+    auto rindex = getIndex(g.rules);
+
+    auto getRegexList = [](const std::vector<yglx::RegexSet*>& rxs) -> std::vector<size_t> {
+        std::vector<size_t> list;
+        for(const auto& rx : rxs) {
+            list.push_back(rx->id);
+        }
+        return list;
+    };
+
+    std::println(os, "rules {}", g.rules.size());
+    for(const auto& r : g.rules) {
+        std::println(os, "{}", zid(r->precedence));
+    }
+
+    std::println(os, "rulesets {}", g.ruleSets.size());
+    for(const auto& rs : g.ruleSets) {
+        writeList(os, getRegexList(rs->firsts));
+        writeList(os, getRegexList(rs->follows));
+        std::println(os, "");
+    }
+
+    std::println(os, "configs {}", g.configs.size());
+    for(const auto& c : g.configs) {
+        std::println(os, "{} {}", rindex.at(&(c->rule)), c->cpos);
+    }
+
+    std::println(os, "itemsets {}", g.itemSets.size());
+    for(const auto& is : g.itemSets) {
+        std::vector<size_t> configs;
+        for(const auto& c : is->configs) {
+            configs.push_back(c->id);
+        }
+        writeList(os, configs);
+
+        std::print(os, " {}", is->shifts.size());
+        for(const auto& s : is->shifts) {
+            std::vector<size_t> epsilons;
+            for(const auto& e : s.second.epsilons) {
+                epsilons.push_back(e->id);
+            }
+            std::print(os, " {} {}", s.first->id, s.second.next->id);
+            writeList(os, epsilons);
+        }
+
+        std::print(os, " {}", is->reduces.size());
+        for(const auto& r : is->reduces) {
+            std::print(os, " {} {} {}", r.first->id, r.second.next->id, r.second.len);
+        }
+
+        std::print(os, " {}", is->gotos.size());
+        for(const auto& gt : is->gotos) {
+            std::print(os, " {} {}", gt.first->id, gt.second->id);
+        }
+        std::println(os, "");
+    }
+
+    std::println(os, "initial {}", zid(g.initialState));
+    std::println(os, "end");
+}
+
+/// @brief restore the automata of @arg g from @arg cfile, if it was saved for the same structure @arg hash
+/// returns false, leaving @arg g untouched, if the file is missing, stale or damaged
+inline auto loadAutomata(yg::Grammar& g, const std::filesystem::path& cfile, const std::string& hash) -> bool {
+    std::ifstream is(cfile);
+    if(!is) {
+        log("automata cache not found: {}", cfile.string());
+        return false;
+    }
+
+    std::string tag;
+    size_t version = 0;
+    std::string chash;
+    is >> tag >> version >> chash;
+    if((tag != CacheTag) || (version != CacheVersion) || (chash != hash)) {
+        log("automata cache out of date: {}", cfile.string());
+        return false;
+    }
+
+    // read and validate the whole file before touching the grammar
+    AtomIndex atoms(g);
+    CacheData cd;
+    try {
+        Reader rd(is, g.pos());
+        readLexer(rd, cd, g, atoms);
+        readParser(rd, cd, g);
+    }catch(const GeneratorError& e) {
+        log("automata cache ignored: {}: {}", cfile.string(), e.msg);
+        return false;
+    }
+
+    applyLexer(g, cd, atoms);
+    applyParser(g, cd);
+    return true;
+}
+
+/// @brief save the automata of @arg g to @arg cfile, tagged with the structure @arg hash
+inline void saveAutomata(const yg::Grammar& g, const std::filesystem::path& cfile, const std::string& hash) {
+    if((hasDenseIds(g.states) == false) || (hasDenseIds(g.configs) == false) || (hasDenseIds(g.itemSets) == false)) {
+        log("automata not cached: ids are not dense");
+        return;
+    }
+
+    AtomIndex atoms(g);
+    std::ostringstream os;
+    std::println(os, "{} {} {}", CacheTag, CacheVersion, hash);
+    writeLexer(os, g, atoms);
+    writeParser(os, g);
+
+    std::ofstream ofs(cfile, std::ios::binary);
+    if(!ofs) {
+        log("automata cache cannot be written: {}", cfile.string());
+        return;
+    }
+    ofs << os.str();
+}
+}
+
+void buildAutomata(yg::Grammar& g, const std::filesystem::path& cfile) {
+    std::string hash;
+    if(cfile.empty() == false) {
+        auto t = timing().phase("loadAutomata");
+
+        // the hash must be taken before the build, which fills in rule precedences
+        hash = getStructureHash(g);
+        if(loadAutomata(g, cfile, hash) == true) {
+            log("automata loaded from cache: {}: states={}, itemsets={}", cfile.string(), g.states.size(), g.itemSets.size());
+            return;
+        }
+    }
+
+    {
+        auto t = timing().phase("buildLexer");
+        buildLexer(g);
+    }
+    {
+        auto t = timing().phase("buildParser");
+        buildParser(g);
+    }
+
+    if(cfile.empty() == false) {
+        auto t = timing().phase("saveAutomata");
+        saveAutomata(g, cfile, hash);
+    }
+}
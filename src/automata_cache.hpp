@@ -0,0 +1,8 @@
+#pragma once
+#include "grammar_yg.hpp"
+
+/// @brief build the lexer and parser automata of @arg g
+/// If @arg cfile is not empty, the automata are read from that cache file when it was
+/// saved for a grammar with the same structure (tokens, rules, precedences and lexer modes).
+/// Otherwise they are built with buildLexer() and buildParser(), and saved to @arg cfile.
+void buildAutomata(yg::Grammar& g, const std::filesystem::path& cfile);
@@ -28,6 +28,7 @@
 #include "text_writer.hpp"
 #include "logger.hpp"
 #include "options.hpp"
+#include "timing.hpp"
 
 /// @brief This is the UNICODE encoding file, embedded as a raw C string
 extern const char* const cb_encoding_utf8;
@@ -55,6 +56,223 @@ extern const char* const cb_filepos;
 
 namespace {
 
+/// @brief Writer for one generated file, rendered in memory
+/// The output is a sequence of parts. Heavy segments are rendered into
+/// child writers on worker threads, and lines that need the absolute row
+/// in the file (#line directives, segment markers) are formatted only
+/// when all parts are spliced together, in order, on close().
+/// The file is left untouched if its content has not changed, so that
+/// dependent translation units are not rebuilt needlessly.
+struct OutputFileWriter : public TextWriter<std::ostringstream> {
+    /// @brief a chunk of output: plain text, a row-dependent line, or a child segment
+    struct Part {
+        std::string text;
+        size_t rows = 0;
+        std::function<std::string(const size_t&)> rowLine;
+        std::shared_ptr<OutputFileWriter> segment;
+
+        /// the destructor of a std::async future waits for the segment,
+        /// so a writer destroyed on an exception never leaves a segment running
+        std::future<void> done;
+    };
+
+    std::filesystem::path file;
+    std::vector<Part> parts;
+
+    /// @brief the error reported by close() if the file cannot be written
+    /// Files are only opened on close(), once their content is known
+    std::string_view openError = "ERROR_OPENING_FILE";
+
+    /// @brief files previously opened on this writer, written on close()
+    /// Keeping them pending lets segments of several files render concurrently
+    std::vector<std::unique_ptr<OutputFileWriter>> previous;
+
+    /// @brief row at which the text in ss begins
+    size_t partRow = 1;
+
+    /// @brief moves the text written so far into a Part
+    inline void seal() {
+        Part part;
+        part.text = ss.str();
+        part.rows = row - partRow;
+        parts.push_back(std::move(part));
+        ss.str("");
+        partRow = row;
+    }
+
+    /// @brief writes a line whose text depends on its row in the final file
+    inline void writelnAt(std::function<std::string(const size_t&)> fn) {
+        seal();
+        Part part;
+        part.rowLine = [ind = indent, fn = std::move(fn)](const size_t& r) {
+            return ind + fn(r);
+        };
+        part.rows = 1;
+        parts.push_back(std::move(part));
+        ++row;
+        partRow = row;
+        wrote = true;
+    }
+
+    /// @brief renders a segment asynchronously into a child writer
+    /// The child is spliced in at the current position on close()
+    template<typename FnT>
+    inline void defer(FnT&& fn) {
+        seal();
+        auto sw = std::make_shared<OutputFileWriter>();
+        sw->file = file;
+        sw->indent = indent;
+        Part part;
+        part.segment = sw;
+        part.done = std::async(std::launch::async, [sw, fn = std::forward<FnT>(fn)]() {
+            fn(*sw);
+        });
+        parts.push_back(std::move(part));
+        wrote = true;
+    }
+
+    /// @brief appends all parts to out, waiting for pending segments
+    inline void render(std::string& out, size_t& orow) {
+        for(auto& part : parts) {
+            if(part.segment) {
+                part.done.get();
+                part.segment->render(out, orow);
+            }else if(part.rowLine) {
+                out += part.rowLine(orow);
+                out += "\n";
+                ++orow;
+            }else{
+                out += part.text;
+                orow += part.rows;
+            }
+        }
+        out += ss.str();
+        orow += (row - partRow);
+    }
+
+    inline void
+    open(const std::filesystem::path& fname, const std::string_view& err) {
+        if(fname.empty()) {
+            return;
+        }
+        if(file.empty() == false) {
+            auto prev = std::make_unique<OutputFileWriter>();
+            prev->file = file;
+            prev->openError = openError;
+            prev->parts = std::move(parts);
+            prev->ss.str(ss.str());
+            prev->row = row;
+            prev->partRow = partRow;
+            previous.push_back(std::move(prev));
+            parts.clear();
+            ss.str("");
+        }
+        row = 1;
+        partRow = 1;
+        file = fname;
+        openError = err;
+    }
+
+    /// @brief returns true if the file at fname already contains text
+    static inline auto isUnchanged(const std::filesystem::path& fname, const std::string& text) -> bool {
+        std::ifstream ifs(fname);
+        if(ifs.is_open() == false) {
+            return false;
+        }
+        std::string existing{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+        return existing == text;
+    }
+
+    /// @brief records the size of the file, and of each segment in it, for the timing report
+    static inline void addTiming(const std::filesystem::path& fname, const std::string& text) {
+        static const std::string_view prefixSegment = "///PROTOTYPE_SEGMENT:";
+        auto& tm = timing();
+        size_t lines = 0;
+        std::string_view segment;
+        size_t slines = 0;
+        size_t sbytes = 0;
+        size_t pos = 0;
+        while(pos < text.size()) {
+            auto eol = text.find('\n', pos);
+            eol = (eol == std::string::npos) ? text.size() : eol + 1;
+            auto line = std::string_view(text).substr(pos, eol - pos);
+            pos = eol;
+            ++lines;
+
+            auto idx = line.find(prefixSegment);
+            if(idx == std::string_view::npos) {
+                ++slines;
+                sbytes += line.size();
+                continue;
+            }
+            auto marker = line.substr(idx + prefixSegment.size());
+            auto name = marker.substr(0, marker.find(':'));
+            if(marker.substr(name.size()).starts_with(":BEGIN") == true) {
+                segment = name;
+                slines = 0;
+                sbytes = 0;
+            }else if((segment.empty() == false) && (name == segment)) {
+                tm.addSegment(fname.string(), std::string(segment), slines, sbytes);
+                segment = {};
+            }
+        }
+        tm.addFile(fname.string(), lines, text.size());
+    }
+
+    /// @brief splices all parts and writes them to the file, if changed
+    inline void close() {
+        for(auto& prev : previous) {
+            prev->close();
+        }
+        previous.clear();
+        if(file.empty()) {
+            return;
+        }
+        std::string out;
+        size_t orow = 1;
+        render(out, orow);
+        parts.clear();
+        ss.str("");
+        auto fname = file;
+        file.clear();
+        if(opts().enableTiming == true) {
+            addTiming(fname, out);
+        }
+        if(isUnchanged(fname, out) == true) {
+            return;
+        }
+        std::ofstream ofs(fname);
+        if(ofs.is_open() == false) {
+            throw GeneratorError(__LINE__, __FILE__, FilePos(), "{}:{}", openError, fname.string());
+        }
+        ofs << out;
+    }
+
+    inline auto isOpen() const -> bool {
+        return (file.empty() == false);
+    }
+
+    inline void
+    swrite(const StringStreamWriter& sw) {
+        if(sw.wrote == false) {
+            return;
+        }
+        TextWriter::write("{}", sw.ss.str());
+        row += (sw.row - 1);
+    }
+
+    inline void
+    swriteln(const StringStreamWriter& sw) {
+        if(sw.wrote == false) {
+            return;
+        }
+        TextWriter::writeln("{}", sw.ss.str());
+        row += (sw.row - 1);
+    }
+};
+
+using OutputFileIndenter = Indenter<OutputFileWriter>;
+
 /// @brief This class generates the cpp parser
 struct Generator {
     const yg::Grammar& grammar;
@@ -64,7 +282,90 @@ struct Generator {
     CodeBlock cb_astNodeDecls;
     CodeBlock throwError;
 
-    inline explicit Generator(const yg::Grammar& g) : grammar(g) {}
+    /// @brief index of each rule in Grammar::rules, used by the hotspot counters
+    /// Rule::id is only unique within its RuleSet
+    std::unordered_map<const ygp::Rule*, size_t> ruleIndex;
+
+    /// @brief visit counts of each Lexer and Parser state, read from the -P profile
+    /// empty when there is no profile, and the states are generated in id order
+    std::vector<uint64_t> lexerStateCounts;
+    std::vector<uint64_t> parserStateCounts;
+
+    inline explicit Generator(const yg::Grammar& g) : grammar(g) {
+        for(size_t idx = 0; idx < grammar.rules.size(); ++idx) {
+            ruleIndex[grammar.rules.at(idx).get()] = idx + 1;
+        }
+        if(opts().profileFile.empty() == false) {
+            loadProfile(opts().profileFile);
+        }
+    }
+
+    /// @brief reads the Lexer and Parser state counts from a hotspot dump
+    /// The parser state descriptions in the dump must match this grammar,
+    /// else the state ids refer to a different state machine
+    inline void loadProfile(const std::string& filename) {
+        std::ifstream is(filename);
+        if(is.is_open() == false) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_PROFILE:{}", filename);
+        }
+
+        lexerStateCounts.assign(grammar.states.size() + 1, 0);
+        parserStateCounts.assign(grammar.itemSets.size() + 1, 0);
+        std::vector<std::string> parserStateNames(grammar.itemSets.size() + 1);
+        for(const auto& ps : grammar.itemSets) {
+            parserStateNames.at(ps->id) = getSingleLine(ps->str("", " | ", false));
+        }
+
+        std::string line;
+        while(std::getline(is, line)) {
+            std::istringstream ss(line);
+            std::string kind;
+            size_t id = 0;
+            uint64_t count = 0;
+            ss >> kind;
+
+            std::vector<uint64_t>* counts = nullptr;
+            if(kind == "lexer_state") {
+                counts = &lexerStateCounts;
+            }else if(kind == "parser_state") {
+                counts = &parserStateCounts;
+            }else{
+                continue;
+            }
+
+            ss >> id >> count;
+            if((ss.fail() == true) || (id == 0) || (id >= counts->size())) {
+                throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "INVALID_PROFILE:{}:{}", filename, line);
+            }
+            if(counts == &parserStateCounts) {
+                std::string desc;
+                ss.ignore(1);
+                std::getline(ss, desc);
+                if(desc != parserStateNames.at(id)) {
+                    throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "PROFILE_MISMATCH:{}:parser_state {}", filename, id);
+                }
+            }
+            counts->at(id) = count;
+        }
+    }
+
+    /// @brief returns @arg states ordered by @arg counts, hottest first
+    /// The states are returned in id order when there is no profile
+    template<typename StateT>
+    static inline auto
+    getOrderedStates(const std::vector<std::unique_ptr<StateT>>& states, const std::vector<uint64_t>& counts) -> std::vector<const StateT*> {
+        std::vector<const StateT*> rv;
+        rv.reserve(states.size());
+        for(const auto& ps : states) {
+            rv.push_back(ps.get());
+        }
+        if(counts.empty() == false) {
+            std::ranges::stable_sort(rv, [&counts](const StateT* lhs, const StateT* rhs) {
+                return counts.at(lhs->id) > counts.at(rhs->id);
+            });
+        }
+        return rv;
+    }
 
     /// @brief expands all variables in a codeblock and normalizes the indentation
     static inline void
@@ -255,7 +556,7 @@ struct Generator {
     /// @brief optionally appends a #line to an expanded codeblock
     static inline void
     generateCodeBlock(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const CodeBlock& codeblock,
         const std::string_view& indent,
         const bool& autoIndent,
@@ -272,15 +573,19 @@ struct Generator {
         unused(indent);
 
         tw.writeln();
-        tw.writeln("{}#line {} \"{}\" //t={},s={}", pline, codeblock.pos.row, codeblock.pos.file, tw.row, sw.row);
+        tw.writelnAt([pline, pos = codeblock.pos, srow = sw.row](const size_t& row) {
+            return std::format("{}#line {} \"{}\" //t={},s={}", pline, pos.row, pos.file, row, srow);
+        });
         tw.swrite(sw);
-        tw.writeln("{}#line {} \"{}\" //t={},s={}", pline, tw.row + 1, tw.file.string(), tw.row, sw.row);
+        tw.writelnAt([pline, file = tw.file.string(), srow = sw.row](const size_t& row) {
+            return std::format("{}#line {} \"{}\" //t={},s={}", pline, row + 1, file, row, srow);
+        });
     }
 
     /// @brief writes expanded codeblock to output stream if the codeblock is not empty
     static inline void
     generatePrototypeLine(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::string_view& line,
         const std::unordered_map<std::string, std::string>& vars,
         const std::string_view& indent
@@ -299,7 +604,7 @@ struct Generator {
     /// This is called at various points in the generation code
     inline void
     generateError(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::string& line,
         const std::string& col,
         const std::string& file,
@@ -317,6 +622,50 @@ struct Generator {
         tw.swriteln(sw);
     }
 
+    /// @brief writes the check that stops the lexer after a parser error, when errors are returned instead of thrown
+    inline void generateFailureCheck(OutputFileWriter& tw, const std::string_view& indent) const {
+        if(opts().errorResult == false) {
+            return;
+        }
+        tw.writeln("{}if(parser.failed == true) {{", indent);
+        tw.writeln("{}    return;", indent);
+        tw.writeln("{}}}", indent);
+    }
+
+    /// @brief returns true if the lexer records its tokens for readParallel(), readUnits() or readDocument()
+    inline bool hasCapture() const {
+        return (opts().parallelLexer == true) || (opts().incremental == true) || (grammar.unitRuleSet != nullptr);
+    }
+
+    /// @brief returns true if the separator set by `%parallel_units` is the last token of a rule of the unit ruleset
+    /// readUnits() then keeps the separator in the unit, otherwise it is parsed between the units
+    inline bool hasUnitSeparator() const {
+        if(grammar.unitRuleSet == nullptr) {
+            return false;
+        }
+        for(const auto* r : grammar.unitRuleSet->rules) {
+            if((r->nodes.size() > 0) && (r->nodes.back()->regexSet == grammar.unitSeparator)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief returns the path of a file generated for a separate unit
+    static inline auto
+    getUnitPath(const std::filesystem::path& filebase, const std::string_view& unit, const std::string_view& ext) -> std::filesystem::path {
+        return std::format("{}_{}{}", filebase.string(), unit, ext);
+    }
+
+    /// @brief returns the specifier for functions that are defined in a separate unit
+    static inline auto
+    getInline() -> std::string_view {
+        if(opts().splitUnits == true) {
+            return "";
+        }
+        return "inline ";
+    }
+
     /// @brief Construct a full function name given a rule and a short function name
     static inline auto
     getFunctionName(const ygp::Rule& r, const std::string& fname) -> std::string {
@@ -443,12 +792,12 @@ struct Generator {
     }
 
     /// @brief generates code to include PCH
-    inline void generatePchHeader(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generatePchHeader(OutputFileWriter& tw, const std::string_view& indent) {
         tw.writeln("{}#include \"{}\"", indent, grammar.pchHeader);
     }
 
     /// @brief generates code to include header files in the parser's header file
-    inline void generateHdrHeaders(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateHdrHeaders(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& h : grammar.hdrHeaders) {
             tw.writeln("{}#include \"{}\"", indent, h);
         }
@@ -462,14 +811,14 @@ struct Generator {
     }
 
     /// @brief generates code to include header files in the parser's source file
-    inline void generateSrcHeaders(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateSrcHeaders(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& h : grammar.srcHeaders) {
             tw.writeln("{}#include \"{}\"", indent, h);
         }
     }
 
     /// @brief generates additional class members for the parser, if any are specified in the .y file
-    inline void generateClassMembers(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateClassMembers(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& m : grammar.classMembers) {
             tw.writeln("{}{};", indent, m);
         }
@@ -516,7 +865,7 @@ struct Generator {
     }
 
     /// @brief generates calls to each walker
-    inline void generateWalkerCallDecls(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateWalkerCallDecls(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& pw : grammar.walkers) {
             auto& w = *pw;
             auto wsig = generateWalkerSig(w);
@@ -524,56 +873,81 @@ struct Generator {
         }
     }
 
+    /// @brief generates the walk() function of a walker
+    inline void generateWalkerWalkDefn(OutputFileWriter& tw, const yg::Walker& w, const std::string_view& indent) {
+        tw.writeln("{}void {}::walk({}& m) {{", indent, w.name, grammar.className);
+        tw.writeln("{}    auto& start = m._impl->ast._root();", indent);
+        tw.writeln("{}    Walker_{}::NodeRef<{}_AST::{}> s(start);", indent, w.name, grammar.className, grammar.start);
+        tw.writeln("{}    go(s);", indent);
+        tw.writeln("{}}}", indent);
+    }
+
     /// @brief generates calls to each walker
-    inline void generateWalkerCallDefns(TextFileWriter& tw, const std::string_view& indent) {
+    /// When generating separate units, walk() is generated in the walker's unit
+    inline void generateWalkerCallDefns(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& pw : grammar.walkers) {
             auto& w = *pw;
             auto wsig = generateWalkerSig(w);
             auto wcall = generateWalkerCall(w);
             tw.writeln("{}void {}::{} {{", indent, qidClassName, wsig);
+            tw.writeln("#if HAS_PROFILER");
+            tw.writeln("{}    auto& sw = stats.walk(\"{}\");", indent, w.name);
+            tw.writeln("{}    ++sw.calls;", indent);
+            tw.writeln("{}    Stats::Timer t(sw.ns);", indent);
+            tw.writeln("#endif");
             tw.writeln("{}    return _impl->walk_{}({});", indent, w.name, wcall);
             tw.writeln("{}}}", indent);
             tw.writeln();
 
-            tw.writeln("{}void {}::walk({}& m) {{", indent, w.name, grammar.className);
-            tw.writeln("{}    auto& start = m._impl->ast._root();", indent);
-            tw.writeln("{}    Walker_{}::NodeRef<{}_AST::{}> s(start);", indent, w.name, grammar.className, grammar.start);
-            tw.writeln("{}    go(s);", indent);
-            tw.writeln("{}}}", indent);
+            if(opts().splitUnits == false) {
+                generateWalkerWalkDefn(tw, w, indent);
+            }
         }
     }
 
+    /// @brief generates the Impl function that calls a walker
+    inline void generateWalkerCallImpl(OutputFileWriter& tw, const yg::Walker& w, const std::string& fname, const std::string_view& indent) {
+        tw.writeln("{}{} {{", indent, fname);
+        auto wname = w.name;
+        if(w.interfaceName.size() > 0) {
+            wname = w.interfaceName;
+        }else if(w.xctor_args.size() > 0) {
+            auto xparams = extractParams(w.xctor_args);
+            tw.writeln("{}    Walker_{} walker(ymodule, {});", indent, w.name, xparams);
+            wname = std::format("Walker_{}", w.name);
+        }else{
+            tw.writeln("{}    Walker_{} walker(ymodule);", indent, w.name);
+            wname = std::format("Walker_{}", w.name);
+        }
+        if(w.outputType == yg::Walker::OutputType::TextFile) {
+            tw.writeln("{}    walker.open(odir, filename);", indent);
+        }
+        tw.writeln("{}    auto& start = ast._root();", indent);
+        tw.writeln("{}    {}::NodeRef<{}_AST::{}> s(start);", indent, wname, grammar.className, grammar.start);
+        tw.writeln("{}    walker.go(s);", indent);
+        tw.writeln("{}}}", indent);
+        tw.writeln();
+    }
+
     /// @brief generates calls to each walker
-    inline void generateWalkerCallImpls(TextFileWriter& tw, const std::string_view& indent) {
+    /// When generating separate units, only the declarations are generated here
+    /// and the definitions go into each walker's unit
+    inline void generateWalkerCallImpls(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& pw : grammar.walkers) {
             auto& w = *pw;
             auto wsig = generateWalkerSig(w);
-            tw.writeln("{}inline void {} {{", indent, wsig);
-            auto wname = w.name;
-            if(w.interfaceName.size() > 0) {
-                wname = w.interfaceName;
-            }else if(w.xctor_args.size() > 0) {
-                auto xparams = extractParams(w.xctor_args);
-                tw.writeln("{}    Walker_{} walker(ymodule, {});", indent, w.name, xparams);
-                wname = std::format("Walker_{}", w.name);
-            }else{
-                tw.writeln("{}    Walker_{} walker(ymodule);", indent, w.name);
-                wname = std::format("Walker_{}", w.name);
-            }
-            if(w.outputType == yg::Walker::OutputType::TextFile) {
-                tw.writeln("{}    walker.open(odir, filename);", indent);
+            if(opts().splitUnits == true) {
+                tw.writeln("{}void {};", indent, wsig);
+                tw.writeln();
+                continue;
             }
-            tw.writeln("{}    auto& start = ast._root();", indent);
-            tw.writeln("{}    {}::NodeRef<{}_AST::{}> s(start);", indent, wname, grammar.className, grammar.start);
-            tw.writeln("{}    walker.go(s);", indent);
-            tw.writeln("{}}}", indent);
-            tw.writeln();
+            generateWalkerCallImpl(tw, w, std::format("inline void {}", wsig), indent);
         }
     }
 
     /// @brief generates declarations for all AST nodes
     inline void generateAstNodeDecls(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::string_view& indent
     ) {
         for (const auto& rs : grammar.ruleSets) {
@@ -582,7 +956,7 @@ struct Generator {
     }
 
     /// @brief generates definitions for all AST nodes
-    inline void generateAstNodeDefns(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateAstNodeDefns(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& rs : grammar.ruleSets) {
             tw.writeln("{}struct {} : public NonCopyable {{", indent, rs->name);
             tw.writeln("{}    const FilePos pos;", indent);
@@ -643,7 +1017,9 @@ struct Generator {
 
         for (const auto& rs : grammar.ruleSets) {
             for (auto& r : rs->rules) {
-                tw.writeln("{}void {}::{}::dump(std::ostream& ss, const size_t& lvl, const FilePos& p, const std::string& indent, const size_t& depth) const {{", indent, rs->name, r->ruleName);
+                // in split mode these definitions live in the shared private header
+                auto inl = (opts().splitUnits == true) ? "inline " : "";
+                tw.writeln("{}{}void {}::{}::dump(std::ostream& ss, const size_t& lvl, const FilePos& p, const std::string& indent, const size_t& depth) const {{", indent, inl, rs->name, r->ruleName);
                 tw.writeln("{}    if(lvl >= 2) {{", indent);
                 tw.writeln(R"({}        ss << std::format("{{}}: {{}}+--{}\n", p.str(), indent);)", indent, r->str(false));
                 for (size_t idx = 0; idx < r->nodes.size(); ++idx) {
@@ -687,7 +1063,7 @@ struct Generator {
     }
 
     /// @brief generates a variant that contains all AST nodes
-    inline void generateAstNodeItems(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateAstNodeItems(OutputFileWriter& tw, const std::string_view& indent) {
         tw.writeln("{}using AstNode = std::variant<", indent);
         tw.writeln("{}    {}::{}", indent, qidNameAST, grammar.tokenClass);
         for (const auto& rs : grammar.ruleSets) {
@@ -698,7 +1074,7 @@ struct Generator {
 
     /// @brief generates visitor overload to invoke the corresponding member function
     inline void generateRuleVisitorBody(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const yg::Walker& walker,
         const yg::Walker::FunctionSig& fsig,
         const ygp::RuleSet& rs,
@@ -733,12 +1109,12 @@ struct Generator {
         tw.writeln("{}            NodeRefPostExec _nrpx;", indent);
 
         if(opts().enableWalkerLogging == true) {
-            tw.writeln("{}    std::println(log(), \"{}:{}\");", indent, hname, r.str(false));
+            tw.writeln("{}    std::println(ymodule.log(), \"{}:{}\");", indent, hname, r.str(false));
         }
 
         // generate node-refs
         for (const auto& n : r.nodes) {
-            if(n->name == grammar.end) {
+            if(n->regexSet == grammar.endRegexSet) {
                 continue;
             }
 
@@ -746,7 +1122,7 @@ struct Generator {
             if(
                 (n->isRule() == true) &&
                 (walker.traversalMode == yg::Walker::TraversalMode::TopDown) &&
-                (n->name != grammar.end) &&
+                (n->regexSet != grammar.endRegexSet) &&
                 ((fsig.isUDF == false) || (fsig.func == walker.defaultFunctionName))
             ) {
                 autowalk = true;
@@ -782,7 +1158,7 @@ struct Generator {
     /// @brief generates writer for Walker
     static inline void
     generateWriter(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const yg::Walker& walker,
         const std::string_view& indent
     ) {
@@ -800,7 +1176,7 @@ struct Generator {
     /// @brief generates Walker Handlers
     inline void generateWalkerHandlers(
         const yg::Walker& walker,
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::unordered_map<std::string, std::string>& vars,
         std::unordered_set<std::string>& xfuncs,
         const std::string_view& indent
@@ -813,7 +1189,7 @@ struct Generator {
             auto& rs = *prs;
             auto funcl = walker.getFunctions(rs);
 
-            // TextFileIndenter twi(tw);
+            // OutputFileIndenter twi(tw);
             for(auto& pfsig : funcl) {
                 const auto& fsig = *pfsig;
                 for(auto& pr : rs.rules) {
@@ -845,7 +1221,7 @@ struct Generator {
 
                     // generate function body, if any
                     if(ci != nullptr) {
-                        TextFileIndenter twi(tw);
+                        OutputFileIndenter twi(tw);
                         generateCodeBlock(tw, ci->codeblock, indent, true, vars);
                     }
                     tw.writeln("{}}}", indent);
@@ -861,7 +1237,7 @@ struct Generator {
     /// @brief generates Walker interface
     inline void generateWalkerInterface(
         const yg::Walker& walker,
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::string_view& wname,
         const std::unordered_map<std::string, std::string>& vars,
         const std::string_view& indent
@@ -871,7 +1247,7 @@ struct Generator {
             tw.writeln("{}struct {} {{", indent, wname);
 
             // generate using-decls for AST nodes
-            if(auto twi = TextFileIndenter(tw)) {
+            if(auto twi = OutputFileIndenter(tw)) {
                 tw.writeln("{}using {} = {}::{};", indent, grammar.tokenClass, qidNameAST, grammar.tokenClass);
                 for(const auto& prs : grammar.ruleSets) {
                     auto& rs = *prs;
@@ -886,7 +1262,7 @@ struct Generator {
             tw.writeln("{}struct {} : public {} {{", indent, wname, bname);
         }
 
-        if(auto twi = TextFileIndenter(tw)) {
+        if(auto twi = OutputFileIndenter(tw)) {
             unused(vars);
             tw.writeln("{}inline {}({}& m) : {}(m) {{}}", indent, wname, grammar.className, bname);
             tw.writeln();
@@ -988,7 +1364,7 @@ struct Generator {
     /// @brief generates Walker interface
     inline void generateWalkerInterfaceExternal(
         const yg::Walker& walker,
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::unordered_map<std::string, std::string>& vars,
         const std::string_view& indent
     ) {
@@ -999,9 +1375,12 @@ struct Generator {
     }
 
     /// @brief generates all Walker's
+    /// When generating separate units, the walker interfaces stay in the private header
+    /// and the function bodies go into one unit per walker
     inline void generateWalkers(
-        TextFileWriter& tw,
+        OutputFileWriter& xtw,
         const std::unordered_map<std::string, std::string>& vars,
+        const std::filesystem::path& filebase,
         const std::string_view& indent
     ) {
         // generate Walker
@@ -1009,25 +1388,31 @@ struct Generator {
             auto& walker = *pwalker;
             auto wname = std::format("{}", walker.name);
 
+            OutputFileWriter utw;
+            if(opts().splitUnits == true) {
+                utw.open(getUnitPath(filebase, std::format("walker_{}", walker.name), ".cpp"), "ERROR_OPENING_SRC");
+                utw.writeln("#include \"{}\"", getUnitPath(filebase, "impl", ".hpp").filename().string());
+                utw.writeln();
+            }
+            auto& tw = (opts().splitUnits == true) ? utw : xtw;
+
             // generate Walker interfaces
             if(walker.interfaceName.size() > 0) {
-                TextFileWriter twi;
-                twi.open(walker.interfaceName + ".hpp");
-                if (twi.isOpen() == false) {
-                    throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_INTERFACE:{}", walker.interfaceName);
-                }
+                OutputFileWriter twi;
+                twi.open(walker.interfaceName + ".hpp", "ERROR_OPENING_INTERFACE");
                 generateWalkerInterfaceExternal(walker, twi, vars, "");
+                twi.close();
                 wname = walker.interfaceName;
             }else{
-                generateWalkerInterface(walker, tw, wname, vars, indent);
+                generateWalkerInterface(walker, xtw, wname, vars, indent);
             }
 
             if(grammar.isRootWalker(walker) == true) {
                 // generate skip implementation
-                tw.writeln("{}template<typename T>", indent);
-                tw.writeln("{}void {}::skip(NodeRef<T>& nr) {{", indent, wname);
-                tw.writeln("{}    nr.called = true;", indent);
-                tw.writeln("{}}}", indent);
+                xtw.writeln("{}template<typename T>", indent);
+                xtw.writeln("{}void {}::skip(NodeRef<T>& nr) {{", indent, wname);
+                xtw.writeln("{}    nr.called = true;", indent);
+                xtw.writeln("{}}}", indent);
             }
 
             for(const auto& prs : grammar.ruleSets) {
@@ -1082,30 +1467,36 @@ struct Generator {
                 tw.writeln("{}struct Walker_{} : public {} {{", indent, walker.name, wname);
                 if(walker.xctor.hasCode() == true) {
                     tw.writeln("{}    inline Walker_{}({}& m{}) : {}(m) {{", indent, walker.name, grammar.className, xargs, wname);
-                    if(auto twi = TextFileIndenter(tw)) {
+                    if(auto twi = OutputFileIndenter(tw)) {
                         generateCodeBlock(tw, walker.xctor, indent, true, vars);
                     }
                     tw.writeln("{}}}", indent);
                 }else{
                     tw.writeln("{}    inline Walker_{}({}& m{}) : {}(m) {{}}", indent, walker.name, grammar.className, xargs, wname);
                 }
-                if(auto twi = TextFileIndenter(tw)) {
+                if(auto twi = OutputFileIndenter(tw)) {
                     generateWriter(tw, walker, indent);
                 }
                 tw.writeln();
 
                 std::unordered_set<std::string> xfuncs;
-                if(auto twi = TextFileIndenter(tw)) {
+                if(auto twi = OutputFileIndenter(tw)) {
                     generateWalkerHandlers(walker, tw, vars, xfuncs, indent);
                 }
                 tw.writeln("{}}};", indent);
                 tw.writeln();
             }
+
+            if(opts().splitUnits == true) {
+                generateWalkerCallImpl(tw, walker, std::format("void {}::Impl::{}", qidClassName, generateWalkerSig(walker)), indent);
+                generateWalkerWalkDefn(tw, walker, indent);
+                utw.close();
+            }
         }
     }
 
     /// @brief generates code to add default Walker, if none specified
-    inline void generateInitWalkers(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateInitWalkers(OutputFileWriter& tw, const std::string_view& indent) {
         for (const auto& pwalker : grammar.walkers) {
             auto& walker = *pwalker;
             if(grammar.isBaseWalker(walker) == true) {
@@ -1117,7 +1508,7 @@ struct Generator {
     }
 
     /// @brief generates code to invoke specified Walker
-    inline void generateWalkerCalls(TextFileWriter& tw, const std::string_view& indent) {
+    inline void generateWalkerCalls(OutputFileWriter& tw, const std::string_view& indent) {
         if(opts().amalgamatedFile == false) {
             return;
         }
@@ -1147,7 +1538,7 @@ struct Generator {
     /// @brief generates all Token IDs inside an enum in the prototype file
     static inline void
     generateTokenIDs(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::unordered_set<std::string>& tnames
     ) {
         for (const auto& t : tnames) {
@@ -1158,7 +1549,7 @@ struct Generator {
     /// @brief generates the string names for all Token IDs inside a map in the prototype file
     static inline void
     generateTokenIDNames(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::unordered_set<std::string>& tnames
     ) {
         for (const auto& t : tnames) {
@@ -1167,9 +1558,9 @@ struct Generator {
     }
 
     /// @brief generates function declarations to create each AST node
-    inline void generateCreateASTNodesDecls(TextFileWriter& tw) {
+    inline void generateCreateASTNodesDecls(OutputFileWriter& tw) {
         for (const auto& rs : grammar.ruleSets) {
-            tw.writeln("template<> inline {}::{}&", qidNameAST, rs->name);
+            tw.writeln("template<> {}{}::{}&", getInline(), qidNameAST, rs->name);
             tw.writeln("Parser::create<{}::{}>(const ValueItem& vi);", qidNameAST, rs->name);
             tw.writeln();
         }
@@ -1177,9 +1568,9 @@ struct Generator {
 
     /// @brief generates functions definitions to create each AST node
     /// These functions are called by the Parser on REDUCE actions
-    inline void generateCreateASTNodesDefns(TextFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
+    inline void generateCreateASTNodesDefns(OutputFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
         for (const auto& rs : grammar.ruleSets) {
-            tw.writeln("template<> inline {}::{}&", qidNameAST, rs->name);
+            tw.writeln("template<> {}{}::{}&", getInline(), qidNameAST, rs->name);
             tw.writeln("Parser::create<{}::{}>(const ValueItem& vi) {{", qidNameAST, rs->name);
             tw.writeln("    switch(vi.ruleID) {{");
 
@@ -1235,11 +1626,22 @@ struct Generator {
         }
     }
 
+    /// @brief return true if a GOTO to @arg itemSet adds a value to a rule of the start ruleset
+    /// such as each statement of a left-recursive list in `start := stmts;`, counted as a top-level item
+    inline auto isStartItem(const ygp::ItemSet& itemSet) const -> bool {
+        for(const auto& c : itemSet.configs) {
+            if((c->rule.ruleSet == grammar.startRuleSet) && (c->cpos > 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /// @brief generates case statements for the Parser
     /// Each case block checks the next Token received from the Lexer
     /// and decides whether to SHIFT, REDUCE or GOTO to the next state
-    inline void generateParserTransitions(TextFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
-        for (const auto& ps : grammar.itemSets) {
+    inline void generateParserTransitions(OutputFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
+        for (const auto* ps : getOrderedStates(grammar.itemSets, parserStateCounts)) {
             auto& itemSet = *ps;
             assert((itemSet.shifts.size() > 0) || (itemSet.reduces.size() > 0) || (itemSet.gotos.size() > 0));
             bool breaked = false;
@@ -1247,6 +1649,9 @@ struct Generator {
             std::string xsep;
 
             tw.writeln("            case {}:", itemSet.id);
+            if(opts().enableHotspots == true) {
+                tw.writeln("                ++hotspots.parserStates[{}];", itemSet.id);
+            }
             if(opts().enableParserLogging == true) {
                 tw.writeln(R"(                std::print(log(), "{{}}", "{}\n");)", itemSet.str("", R"(\n)", true));
             }
@@ -1260,7 +1665,17 @@ struct Generator {
                 }
 
                 tw.writeln("                case Tolkien::ID::{}: // SHIFT", c.first->name);
+                if(grammar.unitRuleSet != nullptr) {
+                    // parseUnit() shifts a unit parsed on another thread in place of its first token
+                    tw.writeln("                    if(unit != nullptr) {{");
+                    tw.writeln("                        spliceUnit();");
+                    tw.writeln("                        return accepted;");
+                    tw.writeln("                    }}");
+                }
                 for(auto& e : c.second.epsilons) {
+                    if(opts().enableHotspots == true) {
+                        tw.writeln("                    ++hotspots.epsilonShifts;");
+                    }
                     tw.writeln("                    shift(k.pos, Tolkien::ID::{}); //EPSILON-S", e->name);
                     tw.writeln("                    stateStack.push_back(0);");
                     tw.writeln("                    reduce(0, 1, 0, Tolkien::ID::{}, \"{}\");", e->name, e->name);
@@ -1269,6 +1684,9 @@ struct Generator {
                 if(opts().enableParserLogging == true) {
                     tw.writeln(R"(                    std::print(log(), "SHIFT {}: t={}\n");)", c.second.next->id, c.first->name);
                 }
+                if(opts().enableTrace == true) {
+                    tw.writeln("                    trace.add(Trace::Kind::Shift, {}, static_cast<uint32_t>(k.id), k.pos);", c.second.next->id);
+                }
                 tw.writeln("                    shift(k);");
                 tw.writeln("                    stateStack.push_back({});", c.second.next->id);
                 tw.writeln("                    return accepted;");
@@ -1285,18 +1703,27 @@ struct Generator {
                 auto len = rd.second.len;
                 while(len < r.nodes.size()) {
                     tw.writeln("                    //shift-epsilon: len={}", len);
+                    if(opts().enableHotspots == true) {
+                        tw.writeln("                    ++hotspots.epsilonShifts;");
+                    }
                     tw.writeln("                    shift(k.pos, Tolkien::ID::{}); //EPSILON-R", grammar.empty);
                     tw.writeln("                    stateStack.push_back(0);");
                     ++len;
                 }
 
-                if ((r.ruleSetName() == grammar.start) && (rd.first->name == grammar.end)) {
+                if ((r.ruleSet == grammar.startRuleSet) && (rd.first == grammar.endRegexSet)) {
                     tw.writeln("                    shift(k.pos, Tolkien::ID::{}); //END", grammar.end);
                     tw.writeln("                    stateStack.push_back(0);");
                 }
+                if(opts().enableHotspots == true) {
+                    tw.writeln("                    ++hotspots.rules[{}];", ruleIndex.at(&r));
+                }
+                if(opts().enableTrace == true) {
+                    tw.writeln("                    trace.add(Trace::Kind::Reduce, {}, {}, k.pos);", itemSet.id, ruleIndex.at(&r));
+                }
                 tw.writeln("                    reduce({}, {}, {}, Tolkien::ID::{}, \"{}\");", r.id, len, r.anchor, r.ruleSetName(), r.ruleSetName());
                 tw.writeln("                    k.id = Tolkien::ID::{};", r.ruleSetName());
-                if (r.ruleSetName() == grammar.start) {
+                if (r.ruleSet == grammar.startRuleSet) {
                     tw.writeln("                    accepted = true;");
                     tw.writeln("                    return accepted;");
                 }else{
@@ -1311,14 +1738,25 @@ struct Generator {
                 if(opts().enableParserLogging == true) {
                     tw.writeln(R"(                    std::print(log(), "GOTO {}:id={}, rule={}\n");)", c.second->id, c.first->id, c.first->name);
                 }
+                if(opts().enableTrace == true) {
+                    tw.writeln("                    trace.add(Trace::Kind::Goto, {}, static_cast<uint32_t>(k.id), k.pos);", c.second->id);
+                }
+                if(isStartItem(*(c.second)) == true) {
+                    tw.writeln("                    ++items;");
+                }
                 tw.writeln("                    stateStack.push_back({});", c.second->id);
                 tw.writeln("                    k = k0;");
                 tw.writeln("                    break;");
                 breaked = true;
             }
             tw.writeln("                default:");
-            auto msg = std::format(R"("SYNTAX_ERROR:received:" + k.str() + ", expected:{}")", xss.str());
-            generateError(tw, "k.pos.row", "k.pos.col", "k.pos.file", msg, "                    ", vars);
+            if(opts().errorResult == true) {
+                tw.writeln(R"(                    failSyntax(k, "{}");)", xss.str());
+                tw.writeln("                    return false;");
+            }else{
+                auto msg = std::format(R"("SYNTAX_ERROR:received:" + k.str() + ", expected:{}")", xss.str());
+                generateError(tw, "k.pos.row", "k.pos.col", "k.pos.file", msg, "                    ", vars);
+            }
             tw.writeln("                }} // switch(k.id)");
             if(breaked == true) {
                 tw.writeln("                break;");
@@ -1326,6 +1764,19 @@ struct Generator {
         }
     }
 
+    /// @brief generates the case statements of Parser::unitGoto()
+    /// one for each parser state with a GOTO on the ruleset set by `%parallel_units`
+    inline void generateUnitGotos(OutputFileWriter& tw, const std::string_view& indent) {
+        if(grammar.unitRuleSet == nullptr) {
+            return;
+        }
+        for (const auto& ps : grammar.itemSets) {
+            if(auto it = ps->gotos.find(grammar.unitRuleSet); it != ps->gotos.end()) {
+                tw.writeln("{}case {}: return {};", indent, ps->id, it->second->id);
+            }
+        }
+    }
+
     /// @brief class to calculate transitions from one Lexer state to the next
     struct TransitionSet {
         const yglx::Transition* wildcard = nullptr;
@@ -1417,10 +1868,89 @@ struct Generator {
         }
     };
 
+    using CharRanges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    /// @brief adds the characters matched by @arg t to @arg ranges
+    static inline auto getRanges(const yglx::RangeClass& t, CharRanges& ranges) -> bool {
+        ranges.emplace_back(t.ch1, t.ch2);
+        return true;
+    }
+
+    /// @brief returns false, the characters matched by a checker function are not known here
+    static inline auto getRanges([[maybe_unused]] const yglx::LargeEscClass& t, [[maybe_unused]] CharRanges& ranges) -> bool {
+        return false;
+    }
+
+    /// @brief adds the characters matched by class @arg t to @arg ranges
+    /// returns false if the class is negated, or has members other than ranges
+    static inline auto getRanges(const yglx::ClassTransition& t, CharRanges& ranges) -> bool {
+        if(t.atom.negate == true) {
+            return false;
+        }
+        for(const auto& ax : t.atom.atoms) {
+            auto* rc = std::get_if<yglx::RangeClass>(&ax);
+            if(rc == nullptr) {
+                return false;
+            }
+            getRanges(*rc, ranges);
+        }
+        return true;
+    }
+
+    /// @brief returns true if the checks @arg lhs and @arg rhs in a Lexer state can be swapped
+    /// This is when both lead to the same state, or when no character matches both
+    template<typename AtomT>
+    static inline auto
+    isReorderable(
+        const std::pair<const yglx::Transition*, const AtomT*>& lhs,
+        const std::pair<const yglx::Transition*, const AtomT*>& rhs
+    ) -> bool {
+        if((lhs.first->next == rhs.first->next) && (lhs.first->capture == rhs.first->capture)) {
+            return true;
+        }
+
+        CharRanges lranges;
+        CharRanges rranges;
+        if((getRanges(*(lhs.second), lranges) == false) || (getRanges(*(rhs.second), rranges) == false)) {
+            return false;
+        }
+        for(const auto& l : lranges) {
+            for(const auto& r : rranges) {
+                if((l.first <= r.second) && (r.first <= l.second)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /// @brief orders the @arg checks in a Lexer state by the visit count of their next state, hottest first
+    /// A check only moves ahead of checks it can be swapped with, so the first matching check is unchanged
+    template<typename AtomT>
+    inline void orderChecks(std::vector<std::pair<const yglx::Transition*, const AtomT*>>& checks) const {
+        if(lexerStateCounts.empty() == true) {
+            return;
+        }
+
+        auto weight = [this](const std::pair<const yglx::Transition*, const AtomT*>& t) -> uint64_t {
+            return lexerStateCounts.at(t.first->next->id);
+        };
+
+        for(size_t i = 1; i < checks.size(); ++i) {
+            auto t = checks.at(i);
+            auto j = i;
+            while((j > 0) && (weight(t) > weight(checks.at(j - 1))) && (isReorderable(t, checks.at(j - 1)) == true)) {
+                checks.at(j) = checks.at(j - 1);
+                --j;
+            }
+            checks.at(j) = t;
+        }
+    }
+
     /// @brief generate code to transition from one Lexer state to another
     static inline void
     generateStateChange(
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const yglx::Transition& t,
         const yglx::State* nextState,
         const std::string& indent
@@ -1432,22 +1962,123 @@ struct Generator {
         tw.writeln("                {}state = {};", indent, nextState->id);
     }
 
+    /// @brief returns @arg s with control characters replaced by spaces
+    /// This keeps each description on one line of the hotspot dump
+    static inline auto getSingleLine(const std::string& s) -> std::string {
+        std::string rv = s;
+        for(auto& ch : rv) {
+            if(static_cast<unsigned char>(ch) < 0x20) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+                ch = ' ';
+            }
+        }
+        return rv;
+    }
+
+    /// @brief returns @arg s as a single-line C++ string literal
+    static inline auto getStringLiteral(const std::string& s) -> std::string {
+        std::string rv = "\"";
+        for(const auto& ch : getSingleLine(s)) {
+            switch(ch) {
+            case '"':
+                rv += "\\\"";
+                break;
+            case '\\':
+                rv += "\\\\";
+                break;
+            default:
+                rv += ch;
+                break;
+            }
+        }
+        rv += "\"";
+        return rv;
+    }
+
+    /// @brief returns a description of Lexer state @arg state for the hotspot dump
+    /// Intermediate states are named after the token whose regex created them,
+    /// which is the last token defined on the same line before the state's position
+    inline auto getLexerStateName(const yglx::State& state) const -> std::string {
+        if(state.matchedRegex != nullptr) {
+            return std::format("{} MATCH {}", state.pos.str(), state.matchedRegex->regexName);
+        }
+        if(state.isRoot == true) {
+            for(const auto& m : grammar.lexerModes) {
+                if(m.second->root == &state) {
+                    return std::format("ROOT {}", (m.first.empty() == true) ? "<default>" : m.first);
+                }
+            }
+        }
+        const yglx::Regex* rx = nullptr;
+        for(const auto& r : grammar.regexes) {
+            if((r->pos.file != state.pos.file) || (r->pos.row != state.pos.row) || (r->pos.col > state.pos.col)) {
+                continue;
+            }
+            if((rx == nullptr) || (r->pos.col > rx->pos.col)) {
+                rx = r.get();
+            }
+        }
+        if(rx != nullptr) {
+            return std::format("{} {}", state.pos.str(), rx->regexName);
+        }
+        return state.pos.str();
+    }
+
+    /// @brief generates the descriptions of each Lexer state, Parser state and rule for the hotspot dump
+    inline void generateHotspotNames(OutputFileWriter& tw, const std::string_view& indent) {
+        if(opts().enableHotspots == false) {
+            return;
+        }
+
+        std::vector<std::string> names(grammar.states.size() + 1);
+        for(const auto& ps : grammar.states) {
+            names.at(ps->id) = getLexerStateName(*ps);
+        }
+        tw.writeln("{}static const std::vector<std::string_view> lexerStateNames = {{", indent);
+        for(const auto& n : names) {
+            tw.writeln("{}    {},", indent, getStringLiteral(n));
+        }
+        tw.writeln("{}}};", indent);
+
+        names.assign(grammar.itemSets.size() + 1, "");
+        for(const auto& ps : grammar.itemSets) {
+            names.at(ps->id) = ps->str("", " | ", false);
+        }
+        tw.writeln("{}static const std::vector<std::string_view> parserStateNames = {{", indent);
+        for(const auto& n : names) {
+            tw.writeln("{}    {},", indent, getStringLiteral(n));
+        }
+        tw.writeln("{}}};", indent);
+
+        tw.writeln("{}static const std::vector<std::string_view> ruleNames = {{", indent);
+        tw.writeln("{}    \"\",", indent);
+        for(const auto& r : grammar.rules) {
+            tw.writeln("{}    {},", indent, getStringLiteral(r->str(false)));
+        }
+        tw.writeln("{}}};", indent);
+    }
+
     /// @brief generate Lexer states
-    inline void generateLexerStates(TextFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
+    inline void generateLexerStates(OutputFileWriter& tw, const std::unordered_map<std::string, std::string>& vars) {
         tw.writeln("            case 0:");
         generateError(tw, "stream.pos.row", "stream.pos.col", "stream.pos.file", "\"LEXER_INTERNAL_ERROR\"", "                ", vars);
 
-        for (const auto& ps : grammar.states) {
+        for (const auto* ps : getOrderedStates(grammar.states, lexerStateCounts)) {
             auto& state = *ps;
 
             TransitionSet tset;
             tset.process(grammar, state.transitions);
             tset.process(grammar, state.superTransitions);
             tset.process(grammar, state.shadowTransitions);
+            orderChecks(tset.largeEscClasses);
+            orderChecks(tset.largeRanges);
+            orderChecks(tset.classes);
 
             tw.writeln("            case {}:", state.id);
+            if(opts().enableHotspots == true) {
+                tw.writeln("                ++parser.hotspots.lexerStates[{}];", state.id);
+            }
             if(state.isRoot == true) {
-                tw.writeln("                token = Tolkien(stream.pos);");
+                tw.writeln("                token.reset(stream.pos);");
             }
 
             if (tset.inLoop.first != nullptr) {
@@ -1497,10 +2128,12 @@ struct Generator {
                 tw.writeln("                if(ch == static_cast<char_t>(EOF)) {{");
                 tw.writeln("                    token.id = Tolkien::ID::{};", grammar.end);
                 tw.writeln("                    parser.parse(token);");
+                generateFailureCheck(tw, "                    ");
                 tw.writeln();
                 tw.writeln("                    // at EOF, call parse() repeatedly until all final reductions are complete");
                 tw.writeln("                    while(parser.isClean() == false) {{");
                 tw.writeln("                        parser.parse(token);");
+                generateFailureCheck(tw, "                        ");
                 tw.writeln("                    }}");
                 tw.writeln("                    state = 0;");
                 tw.writeln("                    stream.consume();");
@@ -1605,9 +2238,19 @@ struct Generator {
 
                 if (state.matchedRegex->usageCount > 0) {
                     tw.writeln("                token.id = Tolkien::ID::{};", state.matchedRegex->regexName);
+                    if(hasCapture() == true) {
+                        // readParallel(), readUnits() and readDocument() scan ahead of the parser and record the tokens
+                        tw.writeln("                if(capture != nullptr) {{");
+                        tw.writeln("                    if(capture->add(token, stream, modes) == false) {{");
+                        tw.writeln("                        return;");
+                        tw.writeln("                    }}");
+                        tw.writeln("                    continue;");
+                        tw.writeln("                }}");
+                    }
                     tw.writeln("                parser.parse(token);");
+                    generateFailureCheck(tw, "                ");
                 }else{
-                    tw.writeln("                token = Tolkien(stream.pos);");
+                    tw.writeln("                token.reset(stream.pos);");
                 }
                 tw.writeln("                continue;");
             }else if (tset.leaveClosure.first != nullptr) {
@@ -1615,6 +2258,9 @@ struct Generator {
                 assert(tset.slide.first == nullptr);
                 tw.writeln("                state = {};", tset.leaveClosure.first->next->id);
                 tw.writeln("                continue; //leaveClosure");
+            }else if(opts().errorResult == true) {
+                tw.writeln("                parser.failToken(stream.pos, token);");
+                tw.writeln("                return;");
             }else{
                 generateError(tw, "stream.pos.row", "stream.pos.col", "stream.pos.file", "std::format(\"TOKEN_ERROR:{}\", token.text)", "                ", vars);
             }
@@ -1627,7 +2273,7 @@ struct Generator {
     inline void
     includeCodeBlock(
         const char* codeBlock,
-        TextFileWriter& tw,
+        OutputFileWriter& tw,
         const std::unordered_map<std::string, std::string>& vars,
         const std::unordered_set<std::string>& tnames,
         const std::filesystem::path& filebase,
@@ -1643,8 +2289,19 @@ struct Generator {
         static std::unordered_set<std::string_view> dontPrintBlocks = {
             "SKIP",
             "IF_HAS_NS",
+            "IF_SPLIT",
             "IF_HAS_LEXER",
-            "IF_LOG_PARSER"
+            "IF_LOG_PARSER",
+            "IF_HOTSPOTS",
+            "IF_TRACE",
+            "IF_THROW",
+            "IF_RESULT",
+            "IF_PARALLEL",
+            "IF_NO_PARALLEL",
+            "IF_UNITS",
+            "IF_NO_UNITS",
+            "IF_CAPTURE",
+            "IF_INCREMENTAL"
         };
 
         enum class Token : uint8_t {
@@ -1684,6 +2341,9 @@ struct Generator {
         bool capturing = false;
         std::vector<std::string_view> eblockNames;
 
+        // skip state outside each open block, so that blocks can be nested
+        std::vector<bool> skips;
+
         while (it != ite) {
             auto itb = it; // NOLINT(readability-qualified-auto)
             auto itl = it; // NOLINT(readability-qualified-auto)
@@ -1782,6 +2442,7 @@ struct Generator {
                 if(opts().enableGeneratorLogging == true) {
                     log("Line::EB:{}, eb={}, lb={}, skip={}", line, eblockName, lblockName, skip);
                 }
+                skips.push_back(skip);
                 if (dontPrintBlocks.contains(eblockName) == false) {
                     tw.writeln("{}", line);
                 }
@@ -1831,6 +2492,15 @@ struct Generator {
                     break;
                 }
 
+                if (eblockName == "IF_SPLIT") {
+                    if(opts().splitUnits == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
                 if (eblockName == "IF_LOG_LEXER") {
                     if(opts().enableLexerLogging == true) {
                         skip = false;
@@ -1849,6 +2519,96 @@ struct Generator {
                     break;
                 }
 
+                if (eblockName == "IF_HOTSPOTS") {
+                    if(opts().enableHotspots == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_TRACE") {
+                    if(opts().enableTrace == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_THROW") {
+                    if(opts().errorResult == true) {
+                        skip = true;
+                    }else{
+                        skip = false;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_RESULT") {
+                    if(opts().errorResult == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_PARALLEL") {
+                    if(opts().parallelLexer == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_NO_PARALLEL") {
+                    if(opts().parallelLexer == true) {
+                        skip = true;
+                    }else{
+                        skip = false;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_UNITS") {
+                    if(grammar.unitRuleSet != nullptr) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_NO_UNITS") {
+                    if(grammar.unitRuleSet != nullptr) {
+                        skip = true;
+                    }else{
+                        skip = false;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_CAPTURE") {
+                    if(hasCapture() == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
+                if (eblockName == "IF_INCREMENTAL") {
+                    if(opts().incremental == true) {
+                        skip = false;
+                    }else{
+                        skip = true;
+                    }
+                    break;
+                }
+
                 if (eblockName == "throwError") {
                     tBlock.clear();
                     assert(capturing == false);
@@ -1875,7 +2635,9 @@ struct Generator {
                     tw.writeln("{}", line);
                 }
                 assert(lblockName == eblockName);
-                skip = false;
+                assert(skips.size() > 0);
+                skip = skips.back();
+                skips.pop_back();
                 if (eblockName == "throwError") {
                     assert(capturing == true);
                     if (throwError.code.empty()) {
@@ -1896,7 +2658,9 @@ struct Generator {
                 if(opts().enableGeneratorLogging == true) {
                     log("Line::SEGMENT:{}", line);
                 }
-                tw.writeln("{}:BEGIN //{}", line, tw.row);
+                tw.writelnAt([line = std::string(line)](const size_t& row) {
+                    return std::format("{}:BEGIN //{}", line, row);
+                });
                 if (segmentName == "pchHeader") {
                     generatePchHeader(tw, indent);
                 }else if (segmentName == "hdrHeaders") {
@@ -1914,11 +2678,15 @@ struct Generator {
                 }else if (segmentName == "astNodeDecls") {
                     generateAstNodeDecls(tw, indent);
                 }else if (segmentName == "astNodeDefns") {
-                    generateAstNodeDefns(tw, indent);
+                    tw.defer([this, indent](OutputFileWriter& stw) {
+                        generateAstNodeDefns(stw, indent);
+                    });
                 }else if (segmentName == "astNodeItems") {
                     generateAstNodeItems(tw, indent);
                 }else if (segmentName == "walkers") {
-                    generateWalkers(tw, vars, indent);
+                    tw.defer([this, &vars, &filebase, indent](OutputFileWriter& stw) {
+                        generateWalkers(stw, vars, filebase, indent);
+                    });
                 }else if (segmentName == "prologue") {
                     generateCodeBlock(tw, grammar.prologue, indent, true, vars);
                 }else if (segmentName == "initWalkers") {
@@ -1936,15 +2704,27 @@ struct Generator {
                 }else if (segmentName == "createASTNodesDecls") {
                     generateCreateASTNodesDecls(tw);
                 }else if (segmentName == "createASTNodesDefns") {
-                    generateCreateASTNodesDefns(tw, vars);
+                    tw.defer([this, &vars](OutputFileWriter& stw) {
+                        generateCreateASTNodesDefns(stw, vars);
+                    });
                 }else if (segmentName == "parserTransitions") {
-                    generateParserTransitions(tw, vars);
+                    tw.defer([this, &vars](OutputFileWriter& stw) {
+                        generateParserTransitions(stw, vars);
+                    });
                 }else if (segmentName == "lexerStates") {
-                    generateLexerStates(tw, vars);
+                    tw.defer([this, &vars](OutputFileWriter& stw) {
+                        generateLexerStates(stw, vars);
+                    });
+                }else if (segmentName == "hotspotNames") {
+                    generateHotspotNames(tw, indent);
+                }else if (segmentName == "unitGotos") {
+                    generateUnitGotos(tw, indent);
                 }else{
                     throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "UNKNOWN_SEGMENT:{}", segmentName);
                 }
-                tw.writeln("{}:END //{}", line, tw.row);
+                tw.writelnAt([line = std::string(line)](const size_t& row) {
+                    return std::format("{}:END //{}", line, row);
+                });
                 break;
             }
             case Token::Include: {
@@ -1971,23 +2751,21 @@ struct Generator {
                 }else if (includeName == "filepos") {
                     includeCodeBlock(cb_filepos, tw, vars, tnames, filebase, srcName, indent);
                 }else if (includeName == "astNodeDeclsBlock") {
-                    TextFileWriter* ptw = &tw;
-                    TextFileWriter xtw;
+                    OutputFileWriter* ptw = &tw;
+                    OutputFileWriter xtw;
                     for(const auto& pw : grammar.walkers) {
                         auto& w = *pw;
                         if(w.interfaceName.size() > 0) {
                             auto astFile = std::format("{}_astnodes.hpp", grammar.className);
-                            xtw.open(astFile);
-                            if(xtw.isOpen() == false) {
-                                throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_AST:{}", astFile);
-                            }
+                            xtw.open(astFile, "ERROR_OPENING_AST");
                             ptw = &xtw;
                             break;
                         }
                     }
             
-                    TextFileWriter& ntw = *ptw;
+                    OutputFileWriter& ntw = *ptw;
                     includeCodeBlock(cb_astNodeDecls.code.c_str(), ntw, vars, tnames, filebase, srcName, indent);
+                    xtw.close();
                 }else{
                     throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "UNKNOWN_INCLUDE:{}", includeName);
                 }
@@ -1998,12 +2776,39 @@ struct Generator {
                 if(opts().enableGeneratorLogging == true) {
                     log("Line::TARGET:{}", line);
                 }
-                if ((opts().amalgamatedFile == false) && (targetName == "SOURCE")) {
-                    auto nsrcName = filebase.string() + ".cpp";
-                    tw.open(nsrcName);
-                    if (tw.isOpen() == false) {
-                        throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_SRC:{}", nsrcName);
+                if (opts().amalgamatedFile == true) {
+                    break;
+                }
+                if (opts().splitUnits == true) {
+                    // the first target opens the private header, the others open a unit each
+                    std::filesystem::path nsrcName;
+                    std::filesystem::path incName;
+                    if (targetName == "SOURCE") {
+                        nsrcName = getUnitPath(filebase, "impl", ".hpp");
+                        incName = srcName;
+                    }else if (targetName == "MODULE") {
+                        nsrcName = filebase.string() + ".cpp";
+                        incName = getUnitPath(filebase, "impl", ".hpp");
+                    }else if ((targetName == "AST") || (targetName == "PARSER") || (targetName == "LEXER")) {
+                        auto unitName = std::string(targetName);
+                        std::ranges::transform(unitName, unitName.begin(), [](const char& ch) {
+                            return static_cast<char>(std::tolower(ch));
+                        });
+                        nsrcName = getUnitPath(filebase, unitName, ".cpp");
+                        incName = getUnitPath(filebase, "impl", ".hpp");
+                    }else{
+                        throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "UNKNOWN_TARGET:{}", targetName);
                     }
+                    tw.open(nsrcName, "ERROR_OPENING_SRC");
+                    if (targetName == "SOURCE") {
+                        tw.writeln("#pragma once");
+                    }
+                    tw.writeln("#include \"{}\"", incName.filename().string());
+                    break;
+                }
+                if (targetName == "SOURCE") {
+                    auto nsrcName = filebase.string() + ".cpp";
+                    tw.open(nsrcName, "ERROR_OPENING_SRC");
                     tw.writeln("#include \"{}\"", std::filesystem::path(srcName).filename().string());
                 }
                 break;
@@ -2022,6 +2827,11 @@ struct Generator {
             }
             }
 
+            // a block nested inside a skipped block is skipped too
+            if((token == Token::EnterBlock) && (skips.size() > 0) && (skips.back() == true)) {
+                skip = true;
+            }
+
             if(it == ite) {
                 continue;
             }
@@ -2052,15 +2862,6 @@ struct Generator {
         if(opts().amalgamatedFile == true) {
             srcName = filebase.string() + ".cpp";
         }
-        TextFileWriter tw;
-        tw.open(srcName);
-        if (tw.isOpen() == false) {
-            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_SRC:{}", srcName);
-        }
-        if(opts().amalgamatedFile == false) {
-            tw.writeln("#pragma once");
-        }
-
         // token IDs
         std::unordered_set<std::string> tnames;
         for (const auto& t : grammar.regexes) {
@@ -2096,10 +2897,147 @@ struct Generator {
             {"START_RULE", std::format("{}", grammar.start)},
             {"START_RULE_NAME", std::format("\"{}\"", grammar.start)},
             {"MAX_REPEAT_COUNT", std::to_string(grammar.maxRepCount)},
+            {"LEXER_STATE_COUNT", std::to_string(grammar.states.size() + 1)},
+            {"PARSER_STATE_COUNT", std::to_string(grammar.itemSets.size() + 1)},
+            {"RULE_COUNT", std::to_string(grammar.rules.size() + 1)},
+            {"TOKEN_COUNT", std::to_string(tnames.size() + 1)},
             {"AST", grammar.astClass},
+            {"INLINE", std::string(getInline())},
+            {"IMPLNS", (opts().splitUnits == true) ? std::format("{}_impl ", qidClassName) : ""},
+            {"IMPLNAME", std::format("{}_impl", qidClassName)},
+            {"UNIT_RULE", (grammar.unitRuleSet != nullptr) ? grammar.unitRuleSet->name : ""},
+            {"UNIT_SEPARATOR", (grammar.unitSeparator != nullptr) ? grammar.unitSeparator->name : ""},
+            {"UNIT_SEPARATOR_IN_UNIT", hasUnitSeparator() ? "true" : "false"},
         };
 
+        // tw is declared after vars, so that segments still pending when an exception
+        // unwinds the stack finish before the variables they read are destroyed
+        OutputFileWriter tw;
+        tw.open(srcName, "ERROR_OPENING_SRC");
+        if(opts().amalgamatedFile == false) {
+            tw.writeln("#pragma once");
+        }
+
         includeCodeBlock(cb_prototype, tw, vars, tnames, filebase, srcName, "");
+        tw.close();
+    }
+};
+
+/// @brief reads the binary trace written by Trace::dump() in prototype.cpp
+/// The record layout and kinds must match struct Trace in prototype.cpp
+struct TraceDecoder {
+    enum class Kind : uint16_t {
+        Lexer = 1,
+        Token = 2,
+        Shift = 3,
+        Reduce = 4,
+        Goto = 5,
+    };
+
+    struct Record {
+        Kind kind;
+        uint16_t col;
+        uint32_t row;
+        uint32_t state;
+        uint32_t value;
+    };
+    static_assert(sizeof(Record) == 16);
+
+    static constexpr uint32_t version = 1;
+
+    const yg::Grammar& grammar;
+    const std::filesystem::path& tfile;
+    std::ifstream is;
+    std::vector<std::string> tokenNames;
+
+    inline TraceDecoder(const yg::Grammar& g, const std::filesystem::path& tf) : grammar(g), tfile(tf), is(tf, std::ios::binary) {
+        if(is.is_open() == false) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "ERROR_OPENING_TRACE:{}", tfile.string());
+        }
+    }
+
+    template<typename T>
+    inline auto get() -> T {
+        T v{};
+        is.read(reinterpret_cast<char*>(&v), sizeof(v));
+        if(is.fail() == true) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "INVALID_TRACE:{}", tfile.string());
+        }
+        return v;
+    }
+
+    inline void check(const uint32_t& count, const size_t& expected, const std::string_view& what) const {
+        if(count != expected) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "TRACE_MISMATCH:{}:{}={}, expected {}", tfile.string(), what, count, expected);
+        }
+    }
+
+    inline auto tokenName(const uint32_t& id) const -> std::string_view {
+        if(id < tokenNames.size()) {
+            return tokenNames.at(id);
+        }
+        return "?";
+    }
+
+    inline void decode(std::ostream& os) {
+        std::array<char, 4> magic{};
+        is.read(magic.data(), magic.size());
+        if((is.fail() == true) || (std::string_view(magic.data(), magic.size()) != "YTRC")) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "INVALID_TRACE:{}", tfile.string());
+        }
+        if((get<uint32_t>() != version) || (get<uint32_t>() != sizeof(Record))) {
+            throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "INVALID_TRACE_VERSION:{}", tfile.string());
+        }
+
+        // the state and rule ids in the trace are only meaningful for the same state machines
+        check(get<uint32_t>(), grammar.states.size() + 1, "lexer_states");
+        check(get<uint32_t>(), grammar.itemSets.size() + 1, "parser_states");
+        check(get<uint32_t>(), grammar.rules.size() + 1, "rules");
+        auto tokenCount = get<uint32_t>();
+        auto total = get<uint64_t>();
+        auto n = get<uint64_t>();
+
+        for(uint32_t i = 0; i < tokenCount; ++i) {
+            std::string name(get<uint16_t>(), ' ');
+            is.read(name.data(), static_cast<std::streamsize>(name.size()));
+            tokenNames.push_back(name);
+        }
+
+        Generator gen(grammar);
+        std::vector<std::string> lexerStateNames(grammar.states.size() + 1);
+        for(const auto& ps : grammar.states) {
+            lexerStateNames.at(ps->id) = gen.getLexerStateName(*ps);
+        }
+
+        std::println(os, "# {} of {} records", n, total);
+        for(uint64_t i = total - n; i < total; ++i) {
+            auto r = get<Record>();
+            auto prefix = std::format("{:>8} {:>5}:{:<4}", i, r.row, r.col);
+            switch(r.kind) {
+            case Kind::Lexer: {
+                auto ch = (r.value == static_cast<uint32_t>(EOF)) ? std::string("EOF") : getChString(r.value);
+                auto name = (r.state < lexerStateNames.size()) ? lexerStateNames.at(r.state) : "";
+                std::println(os, "{} lexer  state={} ch={} {}", prefix, r.state, ch, name);
+                break;
+            }
+            case Kind::Token:
+                std::println(os, "{} token  state={} {}", prefix, r.state, tokenName(r.value));
+                break;
+            case Kind::Shift:
+                std::println(os, "{} shift  {} -> {}", prefix, tokenName(r.value), r.state);
+                break;
+            case Kind::Reduce: {
+                auto rule = ((r.value > 0) && (r.value <= grammar.rules.size())) ? grammar.rules.at(r.value - 1)->str(false) : "?";
+                std::println(os, "{} reduce state={} {}", prefix, r.state, rule);
+                break;
+            }
+            case Kind::Goto:
+                std::println(os, "{} goto   {} -> {}", prefix, tokenName(r.value), r.state);
+                break;
+            default:
+                throw GeneratorError(__LINE__, __FILE__, grammar.pos(), "INVALID_TRACE_RECORD:{}:{}", tfile.string(), i);
+            }
+        }
     }
 };
 }
@@ -2108,3 +3046,8 @@ void generateGrammar(const yg::Grammar& g, const std::filesystem::path& of) {
     Generator gen(g);
     gen.generate(of);
 }
+
+void decodeTrace(const yg::Grammar& g, const std::filesystem::path& tf, std::ostream& os) {
+    TraceDecoder td(g, tf);
+    td.decode(os);
+}
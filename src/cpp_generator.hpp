@@ -4,3 +4,6 @@
 /// @brief entry function to generate cpp parser file
 void generateGrammar(const yg::Grammar& g, const std::filesystem::path& of);
 
+/// @brief prints the binary trace in @arg tf, written by a parser generated from @arg g
+void decodeTrace(const yg::Grammar& g, const std::filesystem::path& tf, std::ostream& os);
+
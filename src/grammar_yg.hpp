@@ -182,14 +182,12 @@ struct Walker : public NonCopyable {
         std::vector<const FunctionSig*> l;
 
         bool defaultFunctionDefined = false;
-        for(const auto& fsig : functionSigs) {
-            if(fsig.first->name == rs.name) {
-                for(const auto& i : fsig.second) {
-                    if(i.func.size() > 0) {
-                        l.push_back(&i);
-                        if(i.func == defaultFunctionName) {
-                            defaultFunctionDefined = true;
-                        }
+        if(auto it = functionSigs.find(&rs); it != functionSigs.end()) {
+            for(const auto& i : it->second) {
+                if(i.func.size() > 0) {
+                    l.push_back(&i);
+                    if(i.func == defaultFunctionName) {
+                        defaultFunctionDefined = true;
                     }
                 }
             }
@@ -315,6 +313,32 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
     std::vector<std::unique_ptr<ygp::Config>> configs;
     std::vector<std::unique_ptr<ygp::ItemSet>> itemSets;
 
+    /// @brief index of RegexSets by name
+    std::unordered_map<std::string, yglx::RegexSet*> regexSetIndex;
+
+    /// @brief index of RuleSets by name
+    std::unordered_map<std::string, ygp::RuleSet*> ruleSetIndex;
+
+    /// @brief the START ruleset, and the END and EMPTY tokensets
+    /// resolved along with the nodes in resolveSymbols()
+    const ygp::RuleSet* startRuleSet = nullptr;
+    const yglx::RegexSet* endRegexSet = nullptr;
+    const yglx::RegexSet* emptyRegexSet = nullptr;
+
+    /// @brief the separator token and the ruleset set by `%parallel_units`
+    /// the input is split at the separators, and each unit is parsed on its own thread
+    FilePos unitsPos;
+    std::string unitSeparatorName;
+    std::string unitRuleSetName;
+    const yglx::RegexSet* unitSeparator = nullptr;
+    const ygp::RuleSet* unitRuleSet = nullptr;
+
+    /// @brief index of configs by rule and dot position
+    std::unordered_map<const ygp::Rule*, std::vector<ygp::Config*>> configIndex;
+
+    /// @brief index of ItemSets by hash of their key
+    std::unordered_map<size_t, std::vector<ygp::ItemSet*>> itemSetIndex;
+
     ygp::ItemSet* initialState = nullptr;
 
     inline auto hasDefaultWalker() const -> const Walker* {
@@ -536,11 +560,9 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
         return _addTransitionToState(s, t);
     }
 
-    inline auto hasRegexSet(const std::string& name) -> yglx::RegexSet* {
-        for(auto& rs : regexSets) {
-            if(rs->name == name) {
-                return rs.get();
-            }
+    inline auto hasRegexSet(const std::string& name) const -> yglx::RegexSet* {
+        if(auto it = regexSetIndex.find(name); it != regexSetIndex.end()) {
+            return it->second;
         }
         return nullptr;
     }
@@ -556,6 +578,7 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
         regexSet->name = name;
         regexSet->precedence = precedence;
         regexSet->assoc = assoc;
+        regexSetIndex[name] = regexSet.get();
         return regexSet.get();
     }
 
@@ -580,16 +603,10 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
         addRegex(regex, assoc);
     }
 
-    inline auto hasRegexSet(const std::string& name) const -> yglx::RegexSet* {
-        for(const auto& t : regexSets) {
-            if(t->name == name) {
-                return t.get();
-            }
+    inline auto getRegexSet(const ygp::Node& node) const -> const yglx::RegexSet& {
+        if(node.regexSet != nullptr) {
+            return *(node.regexSet);
         }
-        return nullptr;
-    }
-
-    inline auto getRegexSet(const ygp::Node& node) const -> yglx::RegexSet& {
         auto* p = hasRegexSet(node.name);
         if(p == nullptr) {
             throw GeneratorError(__LINE__, __FILE__, node.pos, "INVALID_TOKEN:{}", node.name);
@@ -662,17 +679,15 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
         const bool& isEmpty
     ) -> ygp::Rule& {
         ygp::RuleSet* ruleSet = nullptr;
-        for(auto& rs : ruleSets) {
-            if(rs->name == name) {
-                ruleSet = rs.get();
-                break;
-            }
+        if(auto it = ruleSetIndex.find(name); it != ruleSetIndex.end()) {
+            ruleSet = it->second;
         }
         if(ruleSet == nullptr) {
             ruleSets.push_back(std::make_unique<ygp::RuleSet>());
             ruleSet = ruleSets.back().get();
             ruleSet->id = ruleSets.size();
             ruleSet->name = name;
+            ruleSetIndex[name] = ruleSet;
         }
 
         if(isEmpty == true) {
@@ -708,26 +723,133 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
     }
 
     inline auto getRuleSetByName(const FilePos& p, const std::string& name) const -> ygp::RuleSet& {
-        for(const auto& r : ruleSets) {
-            if(r->name == name) {
-                return *r;
-            }
+        if(auto it = ruleSetIndex.find(name); it != ruleSetIndex.end()) {
+            return *(it->second);
         }
         throw GeneratorError(__LINE__, __FILE__, p, "UNKNOWN_RULESET:{}", name);
     }
 
+    inline auto getRuleSet(const ygp::Node& node) const -> const ygp::RuleSet& {
+        if(node.ruleSet != nullptr) {
+            return *(node.ruleSet);
+        }
+        return getRuleSetByName(node.pos, node.name);
+    }
+
+    /// @brief return the number of symbols in the grammar
+    /// All tokensets and rulesets are numbered in a single dense range,
+    /// tokensets first, so that per-symbol data can be held in vectors
+    inline auto getSymbolCount() const -> size_t {
+        return regexSets.size() + ruleSets.size();
+    }
+
+    /// @brief return the symbol id of a tokenset
+    static inline auto getSymbolId(const yglx::RegexSet& rx) -> size_t {
+        assert(rx.id > 0);
+        return rx.id - 1;
+    }
+
+    /// @brief return the symbol id of a ruleset
+    inline auto getSymbolId(const ygp::RuleSet& rs) const -> size_t {
+        assert(rs.id > 0);
+        return regexSets.size() + rs.id - 1;
+    }
+
+    /// @brief return true if @arg sid is the symbol id of a tokenset
+    inline auto isRegexSymbol(const size_t& sid) const -> bool {
+        return sid < regexSets.size();
+    }
+
+    /// @brief return the name of the symbol with id @arg sid
+    inline auto getSymbolName(const size_t& sid) const -> const std::string& {
+        if(isRegexSymbol(sid) == true) {
+            return regexSets.at(sid)->name;
+        }
+        return ruleSets.at(sid - regexSets.size())->name;
+    }
+
+    /// @brief resolve every node in every rule to its ruleset or tokenset
+    /// This is called once after the grammar is parsed, so that the builders
+    /// and the generator do not need to look up symbols by name
+    inline void resolveSymbols() {
+        for(auto& rule : rules) {
+            for(auto& node : rule->nodes) {
+                if(node->isRule()) {
+                    auto& rs = getRuleSetByName(node->pos, node->name);
+                    node->ruleSet = &rs;
+                    node->symbolId = getSymbolId(rs);
+                    continue;
+                }
+                assert(node->isRegex());
+                auto& rx = getRegexSet(*node);
+                node->regexSet = &rx;
+                node->symbolId = getSymbolId(rx);
+            }
+        }
+
+        if(auto it = ruleSetIndex.find(start); it != ruleSetIndex.end()) {
+            startRuleSet = it->second;
+        }
+        endRegexSet = hasRegexSet(end);
+        emptyRegexSet = hasRegexSet(empty);
+
+        if(unitRuleSetName.size() > 0) {
+            unitSeparator = &getRegexSetByName(unitsPos, unitSeparatorName);
+            unitRuleSet = &getRuleSetByName(unitsPos, unitRuleSetName);
+            if(unitRuleSet == startRuleSet) {
+                throw GeneratorError(__LINE__, __FILE__, unitsPos, "INVALID_UNIT_RULESET:{}", unitRuleSetName);
+            }
+        }
+    }
+
     inline auto createConfig(const ygp::Rule& r, const size_t& p) -> ygp::Config& {
         assert(p <= r.nodes.size());
-        for(auto& c : configs) {
-            if((&(c->rule) == &r) && (c->cpos == p)) {
-                return *c;
-            }
+        auto& rconfigs = configIndex[&r];
+        if(rconfigs.size() == 0) {
+            rconfigs.resize(r.nodes.size() + 1, nullptr);
+        }
+        assert(p < rconfigs.size());
+        if(auto* c = rconfigs.at(p)) {
+            return *c;
         }
         configs.push_back(std::make_unique<ygp::Config>(r, p));
         auto& cfg = *(configs.back());
+        cfg.id = configs.size();
+        rconfigs.at(p) = &cfg;
         return cfg;
     }
 
+    inline auto hasConfig(const ygp::Rule& r, const size_t& p) const -> const ygp::Config* {
+        if(auto it = configIndex.find(&r); it != configIndex.end()) {
+            if(p < it->second.size()) {
+                return it->second.at(p);
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief return the lookup key for a list of configs
+    /// The key is the sorted list of config ids, so that the same set of configs
+    /// always maps to the same ItemSet, irrespective of order
+    static inline auto getItemSetKey(const std::vector<const ygp::Config*>& cfgs) -> std::vector<size_t> {
+        std::vector<size_t> key;
+        key.reserve(cfgs.size());
+        for(const auto& c : cfgs) {
+            key.push_back(c->id);
+        }
+        std::ranges::sort(key);
+        return key;
+    }
+
+    /// @brief return the hash of an ItemSet key
+    static inline auto hashItemSetKey(const std::vector<size_t>& key) -> size_t {
+        size_t h = key.size();
+        for(const auto& k : key) {
+            h ^= std::hash<size_t>{}(k) + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+        return h;
+    }
+
     inline auto _createItemSet() -> ygp::ItemSet& {
         itemSets.push_back(std::make_unique<ygp::ItemSet>());
         auto& is = *(itemSets.back());
@@ -737,44 +859,43 @@ struct Grammar : public NonCopyable { // NOLINT(cppcoreguidelines-special-member
 
     inline auto createItemSet(std::vector<const ygp::Config*>& cfgs) -> ygp::ItemSet& {
         auto& is = _createItemSet();
+        is.key = getItemSetKey(cfgs);
         is.configs = std::move(cfgs);
+        itemSetIndex[hashItemSetKey(is.key)].push_back(&is);
         return is;
     }
 
     inline auto hasItemSet(const std::vector<const ygp::Config*>& cfgs) const -> ygp::ItemSet* {
-        for(const auto& is : itemSets) {
-            if(is->configs.size() != cfgs.size()) {
-                continue;
-            }
-
-            auto iit = is->configs.begin();
-            auto iite = is->configs.end();
-            auto cit = cfgs.begin();
-            auto cite = cfgs.end();
-            bool mismatch = false;
-            while((iit != iite) && (cit != cite)) {
-                const auto& icfg = *(*iit);
-                const auto& ccfg = *(*cit);
-
-                if(&(icfg.rule) != &(ccfg.rule)) {
-                    mismatch = true;
-                    break;
-                }
-                if(icfg.cpos != ccfg.cpos) {
-                    mismatch = true;
-                    break;
-                }
-                ++iit;
-                ++cit;
-            }
-            if(mismatch) {
-                continue;
+        auto key = getItemSetKey(cfgs);
+        auto it = itemSetIndex.find(hashItemSetKey(key));
+        if(it == itemSetIndex.end()) {
+            return nullptr;
+        }
+        for(const auto& is : it->second) {
+            if(is->key == key) {
+                return is;
             }
-            return is.get();
         }
         return nullptr;
     }
 
+    /// @brief remove all ItemSets that are not in @arg keep
+    /// the remaining ItemSets are renumbered in their current order
+    /// returns the number of ItemSets removed
+    inline auto retainItemSets(const std::unordered_set<const ygp::ItemSet*>& keep) -> size_t {
+        auto count = std::erase_if(itemSets, [&keep](const auto& is) {
+            return keep.contains(is.get()) == false;
+        });
+
+        itemSetIndex.clear();
+        size_t id = 0;
+        for(auto& is : itemSets) {
+            is->id = ++id;
+            itemSetIndex[hashItemSetKey(is->key)].push_back(is.get());
+        }
+        return count;
+    }
+
     inline auto getItemSet(const FilePos& npos, const std::vector<const ygp::Config*>& cfgs) const -> ygp::ItemSet& {
         auto* is = hasItemSet(cfgs);
         if(is == nullptr) {
@@ -41,6 +41,16 @@ struct Node : public NonCopyable {
     /// @brief autogenerated variable name of this node
     std::string idxName;
 
+    /// @brief dense symbol id of this node, resolved after parsing
+    /// see yg::Grammar::getSymbolId()
+    size_t symbolId = 0;
+
+    /// @brief the ruleset this node refers to, resolved after parsing
+    const RuleSet* ruleSet = nullptr;
+
+    /// @brief the tokenset this node refers to, resolved after parsing
+    const yglx::RegexSet* regexSet = nullptr;
+
     /// @brief return true if this is a ruleset reference
     inline auto isRule() const -> bool {
         return type == NodeType::RuleRef;
@@ -158,17 +168,17 @@ struct RuleSet : public NonCopyable {
     /// used for constructing the LALR state machine
     std::vector<yglx::RegexSet*> follows;
 
-    /// @brief true if @arg list contains @arg name
-    static inline auto hasToken(const std::vector<yglx::RegexSet*>& list, const std::string& name) -> bool {
-        bool found = std::ranges::any_of(list, [&](const auto& rx) -> bool {
-            return rx->name == name;
+    /// @brief true if @arg list contains @arg rx
+    static inline auto hasToken(const std::vector<yglx::RegexSet*>& list, const yglx::RegexSet& rx) -> bool {
+        bool found = std::ranges::any_of(list, [&](const auto& t) -> bool {
+            return t == &rx;
         });
         return found;
     }
 
-    /// @brief true if FIRST-SET contains @arg t
-    inline auto firstIncludes(const std::string& t) const -> bool {
-        return hasToken(firsts, t);
+    /// @brief true if FIRST-SET contains @arg rx
+    inline auto firstIncludes(const yglx::RegexSet& rx) const -> bool {
+        return hasToken(firsts, rx);
     }
 };
 
@@ -176,6 +186,9 @@ struct RuleSet : public NonCopyable {
 /// this is used for constructing the LALR state machine
 /// it stores the @ref Rule and the position of the dot in the @ref Rule
 struct Config : public NonCopyable {
+    /// @brief unique id for this config
+    size_t id = 0;
+
     /// @brief the rule wrapped by this config
     const Rule& rule;
 
@@ -216,19 +229,33 @@ struct ItemSet : public NonCopyable {
         size_t len = 0;
     };
 
+    /// @brief orders the actions of an ItemSet by symbol id
+    /// so that the generated code does not depend on the addresses of the
+    /// symbols, or on the order in which the actions were added
+    struct ById {
+        template<typename T>
+        inline auto operator()(const T* lhs, const T* rhs) const -> bool {
+            return lhs->id < rhs->id;
+        }
+    };
+
     size_t id = 0;
 
     /// @brief this is the list of configs for this item
     std::vector<const Config*> configs;
 
+    /// @brief sorted ids of all configs in this ItemSet
+    /// used to look up an existing ItemSet for a list of configs
+    std::vector<size_t> key;
+
     /// @brief list of SHIFT actions from this ItemSet
-    std::unordered_map<const yglx::RegexSet*, Shift> shifts;
+    std::map<const yglx::RegexSet*, Shift, ById> shifts;
 
     /// @brief list of REDUCE actions from this ItemSet
-    std::unordered_map<const yglx::RegexSet*, Reduce> reduces;
+    std::map<const yglx::RegexSet*, Reduce, ById> reduces;
 
     /// @brief list of GOTO actions from this ItemSet
-    std::unordered_map<const RuleSet*, ItemSet*> gotos;
+    std::map<const RuleSet*, ItemSet*, ById> gotos;
 
     /// @brief check if there is a GOTO action for the given RuleSet @arg rs
     inline auto hasGoto(const RuleSet* rs) const -> ItemSet* {
@@ -273,16 +300,6 @@ struct ItemSet : public NonCopyable {
     //     shifts[&rx].next = std::move(nexts);
     // }
 
-    /// @brief delete SHIFT action for the given token @arg rx
-    /// This is used when resolving a SHIFT-REDUCE conflict in
-    /// favour of a REDUCE
-    inline void delShift(const FilePos& npos, const yglx::RegexSet& rx) {
-        if(hasShift(rx) == nullptr) {
-            throw GeneratorError(__LINE__, __FILE__, npos, "UNKNOWN_SHIFT:{}", rx.name);
-        }
-        shifts.erase(&rx);
-    }
-
     /// @brief check if there is a REDUCE action for the given token @arg rx
     inline auto hasReduce(const yglx::RegexSet& rx) const -> const Config* {
         if(auto it = reduces.find(&rx); it != reduces.end()) {
@@ -2,13 +2,13 @@
 #include "grammar_yg.hpp"
 #include "parser.hpp"
 #include "logger.hpp"
-#include "lexer_builder.hpp"
-#include "parser_builder.hpp"
+#include "automata_cache.hpp"
 #include "cpp_generator.hpp"
 #include "tx_table.hpp"
 #include "grammar_printer.hpp"
 #include "config.hpp"
 #include "options.hpp"
+#include "timing.hpp"
 
 static bool verbose = false;
 
@@ -78,7 +78,7 @@ inline void generateRuleSetAST(
                     continue;
                 }
 
-                auto& crs = g.getRuleSetByName(n->pos, n->name);
+                auto& crs = g.getRuleSet(*n);
                 if(seen.contains(crs.name) == false) {
                     seen.insert(crs.name);
                     std::string part;
@@ -130,27 +130,61 @@ inline void processInputEx(
     if(verbose == true) {
         std::println("Parsing");
     }
-    parseInput(g, stream);
+    {
+        auto t = timing().phase("parseInput");
+        parseInput(g, stream);
+    }
 
     if(verbose == true) {
         std::println("Processing");
     }
-    buildLexer(g);
-    buildParser(g);
+    buildAutomata(g, opts().cacheFile);
+
+    if(opts().traceFile.empty() == false) {
+        decodeTrace(g, opts().traceFile, std::cout);
+        return;
+    }
 
-    generateLexerTable(Logger::olog(), g);
-    generateParserTable(Logger::olog(), g);
-    generateAbSynTree(Logger::olog(), g);
+    {
+        auto t = timing().phase("tables");
+        if(opts().enableTableLogging == true) {
+            generateLexerTable(Logger::olog(), g);
+            generateParserTable(Logger::olog(), g);
+            generateAbSynTree(Logger::olog(), g);
+        }
+        printGrammar(g, opts().gfilename);
+    }
 
     std::filesystem::path d(odir);
     auto f = d / oname;
 
-    printGrammar(g, opts().gfilename);
-
     if(verbose == true) {
         std::println("Generating: {}", f.string());
     }
-    generateGrammar(g, f);
+    {
+        auto t = timing().phase("generateGrammar");
+        generateGrammar(g, f);
+    }
+
+    if(opts().enableTiming == true) {
+        auto& tm = timing();
+        tm.addCount("lexer_modes", g.lexerModes.size());
+        tm.addCount("lexer_states", g.states.size());
+        tm.addCount("lexer_transitions", g.transitions.size());
+        tm.addCount("tokens", g.regexSets.size());
+        tm.addCount("rules", g.rules.size());
+        tm.addCount("rulesets", g.ruleSets.size());
+        tm.addCount("configs", g.configs.size());
+        tm.addCount("itemsets", g.itemSets.size());
+        tm.print(Logger::olog());
+
+        auto jname = d / (oname + ".timing.json");
+        std::ofstream ofs(jname);
+        if(!ofs) {
+            throw GeneratorError(__LINE__, __FILE__, g.pos(), "ERROR_OPENING_TIMING:{}", jname.string());
+        }
+        tm.printJson(ofs);
+    }
 }
 
 inline int
@@ -179,12 +213,20 @@ inline int help(const std::string& xname, const std::string& msg) {
     std::println("    -d <dir>        : output directory");
     std::println("    -n <oname>      : output basename (oname.cpp and oname.hpp will be generated in dir)");
     std::println("    -a              : generate amalgamated file, including main(), which can be compiled into an executable");
+    std::println("    -u              : generate separate .cpp files for the lexer, parser, AST and each walker");
     std::println("    -m              : print console messages");
     std::println("    -v (--version)  : print Yantra version");
     std::println("    -r              : don't generate #line messages");
-    std::println("    -l <logname>    : generate log file to <logname>, use - for console");
-    std::println("    -j <+/-logsrc>  : enable or disable log source <logsrc> (e:g: +lexer, +parser, +generator +walker)");
+    std::println("    -l <logname>    : generate log file to <logname>, use - for console. Also logs the lexer, parser and AST tables");
+    std::println("    -j <+/-logsrc>  : enable or disable log source <logsrc> (e:g: +lexer, +parser, +generator +walker +tables +timing +trace)");
     std::println("    -g <gfilename>  : generate grammar file to <gfilename>");
+    std::println("    -k <cachefile>  : cache the lexer and parser state machines in <cachefile>, and reuse them while the grammar structure is unchanged");
+    std::println("    -p              : generate counters for each lexer state, parser state and rule, written by dumpHotspots() in the generated parser");
+    std::println("    -e              : generate read functions that return lexer and parser errors as a Result instead of throwing them");
+    std::println("    -x              : generate readParallel(), which lexes large inputs in chunks on several threads");
+    std::println("    -i              : generate readDocument() and updateDocument(), which relex only the edited part of a document but parse it again from the last checkpoint before the edits, and snapshot() and restore() for readChunk()");
+    std::println("    -P <profile>    : order the generated lexer and parser code by the visit counts in <profile>, written by dumpHotspots()");
+    std::println("    -T <tracefile>  : decode the binary trace in <tracefile>, written by dumpTrace() in a parser generated with -j +trace");
     return 1;
 }
 
@@ -197,6 +239,11 @@ const Options& opts() {
     return options;
 }
 
+auto timing() -> Timing& {
+    static Timing t;
+    return t;
+}
+
 std::ostream& Logger::olog() {
     if(logc != nullptr) {
         return *logc;
@@ -266,6 +313,7 @@ int main(int argc, const char* argv[]) {
                 return help(argv[0], "invalid log name");
             }
             logname = argv[i];
+            options.enableTableLogging = true;
         }else if(a == "-j") {
             ++i;
             if(i >= argc) {
@@ -281,11 +329,27 @@ int main(int argc, const char* argv[]) {
                 options.enableGeneratorLogging = true;
             }else if(ls == "+walker") {
                 options.enableWalkerLogging = true;
+            }else if(ls == "+tables") {
+                options.enableTableLogging = true;
+            }else if(ls == "+timing") {
+                options.enableTiming = true;
+            }else if(ls == "+trace") {
+                options.enableTrace = true;
             }else{
                 return help(argv[0], "unknown log source:" + ls);
             }
         }else if(a == "-a") {
             options.amalgamatedFile = true;
+        }else if(a == "-u") {
+            options.splitUnits = true;
+        }else if(a == "-p") {
+            options.enableHotspots = true;
+        }else if(a == "-e") {
+            options.errorResult = true;
+        }else if(a == "-x") {
+            options.parallelLexer = true;
+        }else if(a == "-i") {
+            options.incremental = true;
         }else if(a == "-m") {
             verbose = true;
         }else if((a == "-v") || (a == "--version")) {
@@ -299,6 +363,24 @@ int main(int argc, const char* argv[]) {
                 return help(argv[0], "invalid grammar filename");
             }
             options.gfilename = argv[i];
+        }else if(a == "-k") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid cache filename");
+            }
+            options.cacheFile = argv[i];
+        }else if(a == "-P") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid profile filename");
+            }
+            options.profileFile = argv[i];
+        }else if(a == "-T") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid trace filename");
+            }
+            options.traceFile = argv[i];
         }else {
             return help(argv[0], "unknown option:" + a);
         }
@@ -313,6 +395,10 @@ int main(int argc, const char* argv[]) {
         return help(argv[0], "charset should be utf8 or ascii");
     }
 
+    if((options.amalgamatedFile == true) && (options.splitUnits == true)) {
+        return help(argv[0], "-a and -u cannot be used together");
+    }
+
     if((filename.size() == 0) && (string.size() == 0)) {
         return help(argv[0], "at least one filename or string input required");
     }
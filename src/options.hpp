@@ -4,12 +4,20 @@ struct Options {
     /// @brief true to generate an amalgamated .cpp file instead of separate .hpp and .cpp files
     bool amalgamatedFile = false;
 
+    /// @brief true to generate the lexer, parser, AST construction and each walker
+    /// as separate .cpp files that share a private header
+    bool splitUnits = false;
+
     /// @brief true to insert #line statements for codeblocks in the generated file
     bool genLines = true;
 
     /// @brief filename where the AST is logged in markdown format
     std::string gfilename;
 
+    /// @brief file where the lexer and parser state machines are cached between runs
+    /// empty to always build them from scratch
+    std::string cacheFile;
+
     /// @brief enable lexer logging
     bool enableLexerLogging = false;
 
@@ -21,6 +29,43 @@ struct Options {
 
     /// @brief enable walker logging
     bool enableWalkerLogging = false;
+
+    /// @brief record the lexer and parser steps as binary records in a ring buffer in the generated parser
+    /// set by -j +trace, the records are written by the generated dumpTrace()
+    bool enableTrace = false;
+
+    /// @brief write the lexer and parser tables and the AST tree to the log
+    /// set by -l or -j +tables, these are slow to build for large grammars
+    bool enableTableLogging = false;
+
+    /// @brief generate counters for each lexer state, parser state and rule in the generated parser
+    /// set by -p, the counters are written by the generated dumpHotspots()
+    bool enableHotspots = false;
+
+    /// @brief return lexer and parser errors as a Result from the generated read functions instead of throwing
+    /// set by -e, for inputs where errors are common and exceptions are too slow
+    bool errorResult = false;
+
+    /// @brief generate readParallel(), which lexes the chunks of a large input speculatively on several threads
+    /// set by -x, the generated lexer then records its tokens instead of parsing them while scanning ahead
+    bool parallelLexer = false;
+
+    /// @brief generate readDocument() and updateDocument(), which read a document again after edits,
+    /// and snapshot() and restore(), which resume a stream read by readChunk() from an earlier point
+    /// set by -i, the module then keeps the tokens of the document and parser checkpoints into them
+    bool incremental = false;
+
+    /// @brief hotspot dump from a parser generated with -p, used to order the generated lexer and parser
+    /// set by -P, empty to generate the states in id order
+    std::string profileFile;
+
+    /// @brief binary trace written by dumpTrace() in a parser generated with -j +trace
+    /// set by -T, the trace is decoded to the console instead of generating the parser
+    std::string traceFile;
+
+    /// @brief report time and peak memory per phase, and the size of the automata and the generated code
+    /// written to the log, and as JSON to <oname>.timing.json
+    bool enableTiming = false;
 };
 
 auto opts() -> const Options&;
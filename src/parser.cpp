@@ -2084,6 +2084,41 @@ struct Parser {
         read_semi(tr);
     }
 
+    /// @brief read pragma to set the separator token and ruleset of the units that can be parsed in parallel
+    inline void set_units(const Token& s) {
+        Tracer tr{lvl, s.text};
+
+        if(grammar.unitSeparatorName.empty() == false) {
+            throw GeneratorError(__LINE__, __FILE__, s.pos, "INVALID_PRAGMA:{}, already defined", s.text);
+        }
+
+        //%parallel_units SEMI decl;
+        //                ^
+        Token t = peek(tr);
+        if(t.id != Token::ID::ID) {
+            throw GeneratorError(__LINE__, __FILE__, t.pos, "INVALID_INPUT");
+        }
+        if(isRegexName(t.text) == false) {
+            throw GeneratorError(__LINE__, __FILE__, t.pos, "INVALID_PRAGMA_VALUE:{}, should be TOKEN name", t.text);
+        }
+        grammar.unitsPos = t.pos;
+        grammar.unitSeparatorName = t.text;
+        lexer.next();
+
+        //%parallel_units SEMI decl;
+        //                     ^
+        t = peek(tr);
+        if(t.id != Token::ID::ID) {
+            throw GeneratorError(__LINE__, __FILE__, t.pos, "INVALID_INPUT");
+        }
+        if(isRuleName(t.text) == false) {
+            throw GeneratorError(__LINE__, __FILE__, t.pos, "INVALID_PRAGMA_VALUE:{}, should be rule name", t.text);
+        }
+        grammar.unitRuleSetName = t.text;
+        lexer.next();
+        read_semi(tr);
+    }
+
     /// @brief read pragmas
     inline void begin_pragma() {
         Tracer tr{lvl, "pragma"};
@@ -2190,6 +2225,10 @@ struct Parser {
             return set_string(grammar.start, t);
         }
 
+        if(t.text == "parallel_units") {
+            return set_units(t);
+        }
+
         if(t.text == "left") {
             return set_precedence(yglx::RegexSet::Assoc::Left, t);
         }
@@ -2634,11 +2673,13 @@ void parseInput(yg::Grammar& g, Stream& is) {
         }
     }
 
+    // resolve all nodes to their rulesets and tokensets
+    g.resolveSymbols();
+
     // increment usageCount for all regexes
     for(auto& rule : g.rules) {
         for(auto& node : rule->nodes) {
             if(node->isRule()) {
-                g.getRuleSetByName(node->pos, node->name);
                 continue;
             }
             assert(node->isRegex());
@@ -2663,7 +2704,7 @@ void parseInput(yg::Grammar& g, Stream& is) {
         auto& r1 = *pr1;
         assert(r1.nodes.size() > 0);
         auto& n0 = *(r1.nodes.at(0));
-        if((r1.nodes.size() == 1) && (n0.isRegex() == true) && (n0.name == g.empty)) {
+        if((r1.nodes.size() == 1) && (n0.isRegex() == true) && (n0.regexSet == g.emptyRegexSet)) {
             continue;
         }
         for(auto& pr2 : g.rules) {
@@ -2678,7 +2719,7 @@ void parseInput(yg::Grammar& g, Stream& is) {
             for(size_t i = 0; i < r1.nodes.size(); ++i) {
                 auto& n1 = r1.nodes[i];
                 auto& n2 = r2.nodes[i];
-                if(n1->name != n2->name) {
+                if(n1->symbolId != n2->symbolId) {
                     identical = false;
                     break;
                 }
@@ -3,6 +3,132 @@
 #include "logger.hpp"
 
 namespace {
+/// @brief represents a set of tokensets, as a bitset indexed by symbol id
+/// This is used for computing the FIRST-SET and FOLLOW-SET of all symbols
+struct TokenBits {
+    static constexpr size_t WordBits = 64;
+
+    std::vector<uint64_t> words;
+
+    inline TokenBits(const size_t& n) : words((n + WordBits - 1) / WordBits, 0) {}
+
+    /// @brief add @arg i to the set
+    inline void set(const size_t& i) {
+        words.at(i / WordBits) |= (uint64_t{1} << (i % WordBits));
+    }
+
+    /// @brief add all members of @arg rhs to the set
+    /// returns true if the set changed
+    inline bool merge(const TokenBits& rhs) {
+        assert(words.size() == rhs.words.size());
+        bool changed = false;
+        for(size_t w = 0; w < words.size(); ++w) {
+            auto nw = words.at(w) | rhs.words.at(w);
+            if(nw != words.at(w)) {
+                words.at(w) = nw;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /// @brief call @arg fn for each member of the set, in ascending order
+    template<typename FnT>
+    inline void forEach(const FnT& fn) const {
+        for(size_t w = 0; w < words.size(); ++w) {
+            auto bits = words.at(w);
+            while(bits != 0) {
+                auto b = static_cast<size_t>(std::countr_zero(bits));
+                fn((w * WordBits) + b);
+                bits &= (bits - 1);
+            }
+        }
+    }
+};
+
+/// @brief computes F(x) = F'(x) + U{F(y) | x R y} for all x
+/// This is the Digraph algorithm from DeRemer and Pennello,
+/// "Efficient Computation of LALR(1) Look-Ahead Sets".
+/// On entry, @arg sets holds F'(x), on exit it holds F(x).
+/// @arg relation[x] lists all y such that x R y.
+/// Each strongly connected component is visited once, and all its
+/// members share the same final set. The traversal uses an explicit
+/// stack, since the relation can be deep for large grammars.
+inline void digraph(std::vector<TokenBits>& sets, const std::vector<std::vector<size_t>>& relation) {
+    static constexpr size_t Done = std::numeric_limits<size_t>::max();
+
+    assert(sets.size() == relation.size());
+    std::vector<size_t> depth(sets.size(), 0);
+    std::vector<size_t> stack;
+
+    // call frames for the traversal
+    struct Frame {
+        /// @brief the node being visited
+        size_t x = 0;
+
+        /// @brief index of the next relation of x to visit
+        size_t ridx = 0;
+
+        /// @brief depth of the stack when x was entered
+        size_t d = 0;
+    };
+    std::vector<Frame> frames;
+
+    auto enter = [&](const size_t& x) {
+        stack.push_back(x);
+        depth.at(x) = stack.size();
+        frames.push_back({x, 0, stack.size()});
+    };
+
+    for(size_t root = 0; root < sets.size(); ++root) {
+        if(depth.at(root) != 0) {
+            continue;
+        }
+
+        enter(root);
+        while(frames.size() > 0) {
+            auto& f = frames.back();
+            auto x = f.x;
+            auto& rel = relation.at(x);
+            if(f.ridx < rel.size()) {
+                auto y = rel.at(f.ridx);
+                ++f.ridx;
+                if(depth.at(y) == 0) {
+                    enter(y);
+                    continue;
+                }
+                depth.at(x) = std::min(depth.at(x), depth.at(y));
+                if(x != y) {
+                    sets.at(x).merge(sets.at(y));
+                }
+                continue;
+            }
+
+            // all relations of x are done, close the component if x is its root
+            auto d = f.d;
+            frames.pop_back();
+            if(depth.at(x) == d) {
+                while(true) {
+                    auto top = stack.back();
+                    stack.pop_back();
+                    depth.at(top) = Done;
+                    if(top == x) {
+                        break;
+                    }
+                    sets.at(top) = sets.at(x);
+                }
+            }
+
+            // return to the caller
+            if(frames.size() > 0) {
+                auto p = frames.back().x;
+                depth.at(p) = std::min(depth.at(p), depth.at(x));
+                sets.at(p).merge(sets.at(x));
+            }
+        }
+    }
+}
+
 /// @brief represents a set of configs
 /// This is an intermediate data structure used during the
 /// construction of ItemSets in the LALR state machine
@@ -29,6 +155,32 @@ struct CanonicalItemSet : public NonCopyable {
         size_t len = 0;
     };
 
+    /// @brief represents a config that moves into the next ItemSet
+    /// on a SHIFT or a GOTO. Used for propagating lookaheads
+    struct Carry {
+        /// @brief the config in this config set
+        const ygp::Config* from = nullptr;
+
+        /// @brief the config in the next config set
+        const ygp::Config* to = nullptr;
+
+        /// @brief the token for a SHIFT, or null for a GOTO
+        const yglx::RegexSet* rx = nullptr;
+
+        /// @brief the RuleSet for a GOTO, or null for a SHIFT
+        const ygp::RuleSet* rs = nullptr;
+    };
+
+    /// @brief represents a config that is reduced in this config set
+    /// The lookaheads for the REDUCE are computed after all ItemSets are created
+    struct ReduceItem {
+        /// @brief the config to REDUCE
+        const ygp::Config* config = nullptr;
+
+        /// @brief length of the Rule to REDUCE
+        size_t len = 0;
+    };
+
     /// @brief the underlying ItemSet for this config set
     ygp::ItemSet& is;
 
@@ -41,6 +193,12 @@ struct CanonicalItemSet : public NonCopyable {
     /// @brief list of GOTO actions from this config set
     std::unordered_map<const ygp::RuleSet*, std::vector<const ygp::Config*>> gotos;
 
+    /// @brief list of configs carried into the next config sets
+    std::vector<Carry> carries;
+
+    /// @brief list of configs reduced in this config set
+    std::vector<ReduceItem> reduceItems;
+
     /// @brief ctor
     inline CanonicalItemSet(ygp::ItemSet& i) : is(i) {}
 
@@ -106,15 +264,6 @@ struct CanonicalItemSet : public NonCopyable {
         reduces[&rx].next.push_back(&next);
     }
 
-    /// @brief move REDUCEs from another Config to here
-    inline void
-    moveReduces(
-        const yglx::RegexSet& rx,
-        Reduce& r
-    ) {
-        reduces[&rx] = std::move(r);
-    }
-
     /// @brief check if there is a GOTO action for the given RuleSet @arg rs
     inline bool hasGoto(const ygp::RuleSet& rs, const ygp::Config& cfg) const {
         if(auto it = gotos.find(&rs); it != gotos.end()) {
@@ -234,13 +383,17 @@ struct ParserStateMachineBuilder {
         _printConfigList(Logger::olog(), msg, id, configs, indent);
     }
 
+    /// @brief returns true if @arg cfg is in @arg configs
+    /// Configs are unique per rule and position, so they are compared by address.
+    /// A rule can be in the list more than once, at different positions, such as
+    /// `term := LPAREN . expr RPAREN` and `term := . LPAREN expr RPAREN` after an LPAREN
     inline bool
-    hasRuleInConfigList(
+    hasConfigInList(
         const std::vector<const ygp::Config*>& configs,
-        const ygp::Rule& r
+        const ygp::Config& cfg
     ) {
         for(auto& c : configs) {
-            if(&(c->rule) == &r) {
+            if(c == &cfg) {
                 return true;
             }
         }
@@ -260,7 +413,7 @@ struct ParserStateMachineBuilder {
         while(nexts.size() > 0) {
             std::vector<const ygp::Config*> firsts;
             for(auto& c : nexts) {
-                if(hasRuleInConfigList(configs, c->rule)) {
+                if(hasConfigInList(configs, *c)) {
                     continue;
                 }
                 configs.push_back(c);
@@ -272,11 +425,10 @@ struct ParserStateMachineBuilder {
 
                 auto& nextNode = c->getNextNode();
                 if(nextNode.isRule()) {
-                    for(auto& r : grammar.rules) {
-                        if((r->ruleSetName() == nextNode.name)) {
-                            auto& ccfg = grammar.createConfig(*r, 0);
-                            firsts.push_back(&ccfg);
-                        }
+                    auto& rs = grammar.getRuleSet(nextNode);
+                    for(auto& r : rs.rules) {
+                        auto& ccfg = grammar.createConfig(*r, 0);
+                        firsts.push_back(&ccfg);
                     }
                 }
             }
@@ -292,7 +444,7 @@ struct ParserStateMachineBuilder {
 
         // if we are resolving a conflict against the END token,
         // always resolve in favor of a REDUCE.
-        if(rx.name == grammar.end) {
+        if(&rx == grammar.endRegexSet) {
             return 'R';
         }
 
@@ -324,17 +476,16 @@ struct ParserStateMachineBuilder {
         return 'S';
     }
 
+    /// @brief record a REDUCE for @arg config
+    /// the REDUCE actions are added in buildLookaheads(),
+    /// once the lookaheads for all configs are known
     inline void addReduce(
         CanonicalItemSet& cis,
         const ygp::Config& config,
         const size_t& len,
         const std::string& /*indent*/
     ) {
-        auto& rs = grammar.getRuleSetByName(config.rule.pos, config.rule.ruleSetName());
-        for(auto& prx : rs.follows) {
-            auto& rx = *prx;
-            cis.addReduce(rx, config, len);
-        }
+        cis.reduceItems.push_back({&config, len});
     }
 
     inline void addShift(
@@ -346,31 +497,25 @@ struct ParserStateMachineBuilder {
         const std::string& indent
     ) {
         log("{}addShift:cfg={}, next=regex", indent, config.str());
-        if(nextNode.name == grammar.empty) {
+        if(nextNode.regexSet == grammar.emptyRegexSet) {
             log("{}addShift:skip_empty", indent);
             return;
         }
 
         auto& rx = grammar.getRegexSet(nextNode);
-        if(cis.hasReduce(rx) != nullptr) {
-            char p = resolveConflict(config, rx, indent);
-            if(p == 'R') {
-                return;
-            }
-            cis.reduces.erase(&rx);
-        }
+        auto& ncfg = grammar.createConfig(config.rule, cpos + 1);
+        cis.carries.push_back({&config, &ncfg, &rx, nullptr});
 
         bool hasExisting = false;
         if(cis.hasShift(rx)) {
             for(auto& xcfg : cis.shifts[&rx].next) {
-                 if(&(xcfg->rule) == &(config.rule)) {
+                 if(xcfg == &ncfg) {
                     hasExisting = true;
                     break;
                 }
             }
         }
         if(hasExisting == false) {
-            auto& ncfg = grammar.createConfig(config.rule, cpos + 1);
             cis.addShift(rx, ncfg, epsilons);
         }
     }
@@ -386,9 +531,10 @@ struct ParserStateMachineBuilder {
 
         // add GOTO for rule node
         auto& ncfg = grammar.createConfig(config.rule, cpos + 1);
-        auto& rs = grammar.getRuleSetByName(nextNode.pos, nextNode.name);
+        auto& rs = grammar.getRuleSet(nextNode);
         assert(cis.hasGoto(rs, ncfg) == false);
         cis.gotos[&rs].push_back(&ncfg);
+        cis.carries.push_back({&config, &ncfg, nullptr, &rs});
     }
 
     std::unordered_map<const ygp::ItemSet*, std::unique_ptr<CanonicalItemSet>> cisList;
@@ -433,10 +579,10 @@ struct ParserStateMachineBuilder {
                     log("{}getNextConfigSet:is-end:len={}", indent, len);
                     addReduce(cis, config, len, indent);
                 }else if(nextNode->isRegex()) {
-                    if(nextNode->name == grammar.empty) {
+                    if(nextNode->regexSet == grammar.emptyRegexSet) {
                         log("{}getNextConfigSet:is-regex-empty:{}", indent, nextNode->name);
                     //     epsilonNode = nextNode;
-                    }else if(nextNode->name == grammar.end) {
+                    }else if(nextNode->regexSet == grammar.endRegexSet) {
                         auto len = config.rule.nodes.size() - (cpos - config.cpos);
                         log("{}getNextConfigSet:is-regex-end:{}, len={}, cfg={}", indent, nextNode->name, len, config.str(false));
                         assert(len > 0);
@@ -449,8 +595,9 @@ struct ParserStateMachineBuilder {
                     log("{}getNextConfigSet:is-rule:{}", indent, nextNode->name);
                     if(first == true) {
                         addGoto(*nextNode, cis, config, cpos, indent);
-                        auto& rs = grammar.getRuleSetByName(nextNode->pos, nextNode->name);
-                        if(rs.firstIncludes(grammar.empty) == true) {
+                        auto& rs = grammar.getRuleSet(*nextNode);
+                        assert(grammar.emptyRegexSet != nullptr);
+                        if(rs.firstIncludes(*(grammar.emptyRegexSet)) == true) {
                             epsilonNode = nextNode;
                             epsilons.push_back(&rs);
                         }
@@ -495,6 +642,8 @@ struct ParserStateMachineBuilder {
         getNextCanonicalItemSet(is.configs, cis, indent);
 
         auto& ncis = createCanonicalItemSet(is);
+        ncis.carries = std::move(cis.carries);
+        ncis.reduceItems = std::move(cis.reduceItems);
 
         // set is.shifts
         for(auto& c : cis.shifts) {
@@ -504,13 +653,6 @@ struct ParserStateMachineBuilder {
             ncis.moveShifts(*rx, xcfgs, cfgs.epsilons);
         }
 
-        // set is.reduces
-        for(auto& c : cis.reduces) {
-            auto& rx = c.first;
-            auto& cfgs = c.second;
-            ncis.moveReduces(*rx, cfgs);
-        }
-
         // set is.gotos
         for(auto& c : cis.gotos) {
             auto& rs = c.first;
@@ -580,17 +722,8 @@ struct ParserStateMachineBuilder {
                 }
 
                 // assert(cfgs.next.size() == 1);
+                // shift/reduce conflicts are already resolved in buildLookaheads()
                 auto& config = *(cfgs.next.at(0));
-                if(is.hasShift(rx) != nullptr) {
-                    auto p = resolveConflict(config, rx, "");
-                    // if resolved in favor of SHIFT, skip adding REDUCE
-                    if(p == 'S') {
-                        continue;
-                    }
-                    // remove existing SHIFT, and go on to add REDUCE
-                    is.delShift(config.rule.pos, rx);
-                }
-
                 auto& lastNode = *(config.rule.nodes.back());
                 assert(is.hasShift(rx) == nullptr);
                 assert(is.hasReduce(rx) == nullptr);
@@ -599,23 +732,283 @@ struct ParserStateMachineBuilder {
         }
     }
 
+    /// @brief return the FIRST-SET of the nodes after the dot in @arg config, as a bitset
+    /// @arg nullable is set to true if all the nodes after the dot are nullable
+    inline TokenBits
+    getTailFirsts(
+        const ygp::Config& config,
+        const std::vector<TokenBits>& rsFirsts,
+        bool& nullable
+    ) const {
+        TokenBits firsts(grammar.regexSets.size());
+        nullable = true;
+        for(size_t i = config.cpos + 1; i < config.rule.nodes.size(); ++i) {
+            auto& n = config.rule.getNode(i);
+            if(n.isRegex() == true) {
+                if(n.regexSet == grammar.emptyRegexSet) {
+                    continue;
+                }
+                firsts.set(n.symbolId);
+                nullable = false;
+                break;
+            }
+
+            auto& rs = grammar.getRuleSet(n);
+            firsts.merge(rsFirsts.at(rs.id - 1));
+            if(rs.firstIncludes(*(grammar.emptyRegexSet)) == false) {
+                nullable = false;
+                break;
+            }
+        }
+        return firsts;
+    }
+
+    /// @brief count the REDUCE entries and conflicts in all ItemSets
+    /// @arg getLookaheads returns the lookaheads for a REDUCE in an ItemSet
+    template<typename FnT>
+    inline std::pair<size_t, size_t> countReduces(const FnT& getLookaheads) {
+        size_t entries = 0;
+        size_t conflicts = 0;
+        for(auto& pis : grammar.itemSets) {
+            auto& ncis = getCanonicalItemSet(*pis);
+            std::unordered_map<size_t, size_t> counts;
+            for(auto& ri : ncis.reduceItems) {
+                getLookaheads(*pis, ri).forEach([&](const size_t& t) {
+                    ++counts[t];
+                });
+            }
+            for(auto& c : counts) {
+                ++entries;
+                auto& rx = *(grammar.regexSets.at(c.first));
+                if((c.second > 1) || (ncis.hasShift(rx) != nullptr)) {
+                    ++conflicts;
+                }
+            }
+        }
+        return {entries, conflicts};
+    }
+
+    /// @brief compute the LALR(1) lookaheads for all REDUCEs, and add the REDUCE actions
+    /// Every config in every ItemSet has its own lookahead set.
+    /// - a config in the initial ItemSet for the start rule is followed by END
+    /// - a config that adds a rule to the closure of its ItemSet gives that
+    ///   rule the FIRST-SET of the nodes after it, and its own lookaheads if
+    ///   those nodes are nullable
+    /// - a config carried into the next ItemSet by a SHIFT or GOTO gives
+    ///   its lookaheads to the carried config
+    /// The last two form the includes relation, which is solved with digraph()
+    /// so that each config is visited once, irrespective of grammar size.
+    /// The relation is built on configs rather than on the GOTOs of the
+    /// ItemSets, as in DeRemer and Pennello, because a nullable RuleSet
+    /// can be skipped by a SHIFT with epsilons, without a GOTO.
+    inline void buildLookaheads(const ygp::ItemSet& sis) {
+        auto tokenCount = grammar.regexSets.size();
+
+        // number all the configs in all ItemSets
+        std::vector<std::unordered_map<const ygp::Config*, size_t>> nodeIds(grammar.itemSets.size());
+        size_t nodeCount = 0;
+        for(auto& pis : grammar.itemSets) {
+            assert(pis->id > 0);
+            auto& ids = nodeIds.at(pis->id - 1);
+            for(auto& c : pis->configs) {
+                ids[c] = nodeCount++;
+            }
+        }
+
+        auto getNodeId = [&nodeIds](const ygp::ItemSet& is, const ygp::Config* c) -> size_t {
+            auto& ids = nodeIds.at(is.id - 1);
+            if(auto it = ids.find(c); it != ids.end()) {
+                return it->second;
+            }
+            return std::numeric_limits<size_t>::max();
+        };
+
+        std::vector<TokenBits> rsFirsts(grammar.ruleSets.size(), TokenBits(tokenCount));
+        for(auto& rs : grammar.ruleSets) {
+            for(auto& rx : rs->firsts) {
+                if(rx != grammar.emptyRegexSet) {
+                    rsFirsts.at(rs->id - 1).set(grammar.getSymbolId(*rx));
+                }
+            }
+        }
+
+        std::vector<TokenBits> lookaheads(nodeCount, TokenBits(tokenCount));
+        std::vector<std::vector<size_t>> includes(nodeCount);
+
+        // the start rule is followed by END
+        assert(grammar.endRegexSet != nullptr);
+        for(auto& c : sis.configs) {
+            if((c->rule.ruleSet == grammar.startRuleSet) && (c->cpos == 0)) {
+                lookaheads.at(getNodeId(sis, c)).set(grammar.getSymbolId(*(grammar.endRegexSet)));
+            }
+        }
+
+        std::unordered_map<const ygp::Config*, std::pair<TokenBits, bool>> tails;
+        for(auto& pis : grammar.itemSets) {
+            auto& is = *pis;
+            auto& ncis = getCanonicalItemSet(is);
+
+            // closure
+            for(auto& c : is.configs) {
+                auto* nextNode = c->rule.getNodeAt(c->cpos);
+                if((nextNode == nullptr) || (nextNode->isRule() == false)) {
+                    continue;
+                }
+
+                auto it = tails.find(c);
+                if(it == tails.end()) {
+                    bool nullable = false;
+                    auto firsts = getTailFirsts(*c, rsFirsts, nullable);
+                    it = tails.emplace(c, std::make_pair(std::move(firsts), nullable)).first;
+                }
+                auto& [firsts, nullable] = it->second;
+
+                auto from = getNodeId(is, c);
+                for(auto& r : grammar.getRuleSet(*nextNode).rules) {
+                    auto* cc = grammar.hasConfig(*r, 0);
+                    auto to = getNodeId(is, cc);
+                    if(to >= nodeCount) {
+                        continue;
+                    }
+                    lookaheads.at(to).merge(firsts);
+                    if(nullable == true) {
+                        includes.at(to).push_back(from);
+                    }
+                }
+            }
+
+            // SHIFTs and GOTOs
+            std::unordered_map<const yglx::RegexSet*, const ygp::ItemSet*> shiftNexts;
+            std::unordered_map<const ygp::RuleSet*, const ygp::ItemSet*> gotoNexts;
+            for(auto& cr : ncis.carries) {
+                const ygp::ItemSet* nis = nullptr;
+                if(cr.rx != nullptr) {
+                    auto it = shiftNexts.find(cr.rx);
+                    if(it == shiftNexts.end()) {
+                        it = shiftNexts.emplace(cr.rx, grammar.hasItemSet(ncis.shifts.at(cr.rx).next)).first;
+                    }
+                    nis = it->second;
+                }else{
+                    auto it = gotoNexts.find(cr.rs);
+                    if(it == gotoNexts.end()) {
+                        it = gotoNexts.emplace(cr.rs, grammar.hasItemSet(ncis.gotos.at(cr.rs))).first;
+                    }
+                    nis = it->second;
+                }
+                if(nis == nullptr) {
+                    continue;
+                }
+
+                auto to = getNodeId(*nis, cr.to);
+                if(to >= nodeCount) {
+                    continue;
+                }
+                includes.at(to).push_back(getNodeId(is, cr.from));
+            }
+        }
+
+        digraph(lookaheads, includes);
+
+        // log the REDUCE entries and conflicts, along with the SLR(1) counts
+        std::vector<TokenBits> rsFollows(grammar.ruleSets.size(), TokenBits(tokenCount));
+        for(auto& rs : grammar.ruleSets) {
+            for(auto& rx : rs->follows) {
+                rsFollows.at(rs->id - 1).set(grammar.getSymbolId(*rx));
+            }
+        }
+        auto [slrEntries, slrConflicts] = countReduces([&](const ygp::ItemSet&, const CanonicalItemSet::ReduceItem& ri) -> const TokenBits& {
+            return rsFollows.at(ri.config->rule.ruleSet->id - 1);
+        });
+        auto [lalrEntries, lalrConflicts] = countReduces([&](const ygp::ItemSet& is, const CanonicalItemSet::ReduceItem& ri) -> const TokenBits& {
+            return lookaheads.at(getNodeId(is, ri.config));
+        });
+        log("LALR(1): reduce-entries={}, conflicts={}, SLR(1): reduce-entries={}, conflicts={}", lalrEntries, lalrConflicts, slrEntries, slrConflicts);
+
+        // add REDUCEs
+        // a REDUCE on a token that is also SHIFTed is resolved against the shifting config with the highest precedence,
+        // the first one in the closure if several have the same, so that the result does not depend on which config comes first
+        for(auto& pis : grammar.itemSets) {
+            auto& is = *pis;
+            auto& ncis = getCanonicalItemSet(is);
+            for(auto& ri : ncis.reduceItems) {
+                lookaheads.at(getNodeId(is, ri.config)).forEach([&](const size_t& t) {
+                    auto& rx = *(grammar.regexSets.at(t));
+                    if(ncis.hasShift(rx) != nullptr) {
+                        const ygp::Config* shifting = nullptr;
+                        for(auto& cr : ncis.carries) {
+                            if((cr.rx == &rx) && ((shifting == nullptr) || (cr.from->rule.precedence->precedence > shifting->rule.precedence->precedence))) {
+                                shifting = cr.from;
+                            }
+                        }
+                        assert(shifting != nullptr);
+                        if(resolveConflict(*shifting, rx, "") != 'R') {
+                            return;
+                        }
+                        ncis.shifts.erase(&rx);
+                    }
+                    ncis.addReduce(rx, *(ri.config), ri.len);
+                });
+            }
+        }
+    }
+
+    /// @brief remove all ItemSets that cannot be reached from the initial ItemSet @arg sis
+    /// This happens when a SHIFT is removed while resolving a conflict in favor of a REDUCE
+    inline void pruneItemSets(const ygp::ItemSet& sis) {
+        std::unordered_set<const ygp::ItemSet*> reached;
+        std::vector<const ygp::ItemSet*> pending;
+        reached.insert(&sis);
+        pending.push_back(&sis);
+        while(pending.size() > 0) {
+            auto& is = *(pending.back());
+            pending.pop_back();
+            for(auto& s : is.shifts) {
+                if(reached.insert(s.second.next).second == true) {
+                    pending.push_back(s.second.next);
+                }
+            }
+            for(auto& g : is.gotos) {
+                if(reached.insert(g.second).second == true) {
+                    pending.push_back(g.second);
+                }
+            }
+        }
+
+        if(reached.size() == grammar.itemSets.size()) {
+            return;
+        }
+
+        std::erase_if(cisList, [&reached](const auto& c) {
+            return reached.contains(c.first) == false;
+        });
+        auto count = grammar.retainItemSets(reached);
+        log("pruned {} unreachable ItemSets", count);
+    }
+
     struct Links {
         const yg::Grammar& grammar;
-        std::unordered_map<std::string, std::set<std::string>> firsts;
-        std::unordered_map<std::string, std::set<std::string>> follows;
-        std::set<std::string> nullable;
 
-        inline Links(const yg::Grammar& g) : grammar(g) {}
+        /// @brief FIRST-SET and FOLLOW-SET of every symbol, indexed by symbol id
+        std::vector<TokenBits> firsts;
+        std::vector<TokenBits> follows;
+
+        /// @brief whether a symbol is nullable, indexed by symbol id
+        std::vector<bool> nullable;
 
-        static inline std::string str(const std::set<std::string>& set) {
+        inline Links(const yg::Grammar& g)
+            : grammar(g)
+            , firsts(g.getSymbolCount(), TokenBits(g.regexSets.size()))
+            , follows(g.getSymbolCount(), TokenBits(g.regexSets.size()))
+            , nullable(g.getSymbolCount(), false) {}
+
+        inline std::string str(const TokenBits& set) const {
             std::stringstream ss;
             std::string sep;
             ss << "[";
-            sep = "";
-            for(auto& f : set) {
-                ss << sep << f;
+            set.forEach([&](const size_t& f) {
+                ss << sep << grammar.getSymbolName(f);
                 sep = ", ";
-            }
+            });
             ss << "]";
             return ss.str();
         }
@@ -623,215 +1016,232 @@ struct ParserStateMachineBuilder {
         [[maybe_unused]]
         inline std::string str() const {
             std::stringstream ss;
-            for(auto& ff : firsts) {
-                ss << "  FIRST(" << ff.first << ") <- " << str(ff.second) << "\n";
+            for(size_t sid = 0; sid < firsts.size(); ++sid) {
+                ss << "  FIRST(" << grammar.getSymbolName(sid) << ") <- " << str(firsts.at(sid)) << "\n";
             }
-            for(auto& ff : follows) {
-                ss << "  FOLLOW(" << ff.first << ") <- " << str(ff.second) << "\n";
+            for(size_t sid = 0; sid < follows.size(); ++sid) {
+                ss << "  FOLLOW(" << grammar.getSymbolName(sid) << ") <- " << str(follows.at(sid)) << "\n";
             }
 
-            ss << "  NULLABLE <- " << str(nullable) << "\n";
+            std::stringstream ns;
+            std::string sep;
+            for(size_t sid = 0; sid < nullable.size(); ++sid) {
+                if(nullable.at(sid) == true) {
+                    ns << sep << grammar.getSymbolName(sid);
+                    sep = ", ";
+                }
+            }
+            ss << "  NULLABLE <- [" << ns.str() << "]\n";
             return ss.str();
         }
 
         inline bool isNullable(const ygp::Node& node) const {
-            if(nullable.contains(node.name) == true) {
+            if(nullable.at(node.symbolId) == true) {
                 return true;
             }
 
-            if(node.name == grammar.empty) {
+            if(node.regexSet == grammar.emptyRegexSet) {
                 return true;
             }
             return false;
         }
 
-        inline bool isRuleNullable(const ygp::Rule& rule, const size_t& from, const size_t& to) const {
-            assert(to >= from);
-            assert(from <= rule.nodes.size());
-            assert(to <= rule.nodes.size());
-            if(to == from) {
-                return false;
+        /// @brief propagate @arg sets along @arg edges until no set changes
+        /// edges[src] lists all symbols whose set must include the set of src
+        static inline void propagate(std::vector<TokenBits>& sets, const std::vector<std::vector<size_t>>& edges) {
+            std::vector<size_t> worklist;
+            std::vector<bool> queued(sets.size(), true);
+            worklist.reserve(sets.size());
+            for(size_t sid = 0; sid < sets.size(); ++sid) {
+                worklist.push_back(sid);
             }
 
-            for(size_t i = from; i < to; ++i) {
-                auto& n1 = rule.getNode(i);
-                if(isNullable(n1) == false) {
-                    return false;
+            while(worklist.size() > 0) {
+                auto src = worklist.back();
+                worklist.pop_back();
+                queued.at(src) = false;
+                for(auto& dst : edges.at(src)) {
+                    if(dst == src) {
+                        continue;
+                    }
+                    if((sets.at(dst).merge(sets.at(src)) == true) && (queued.at(dst) == false)) {
+                        queued.at(dst) = true;
+                        worklist.push_back(dst);
+                    }
                 }
             }
-            return true;
         }
 
-        static inline size_t _addToSet(std::set<std::string>& set, const std::string& s) {
-            if(set.contains(s) == true) {
-                return 0;
-            }
-            set.insert(s);
-            return 1;
-        }
-
-        inline size_t addNullable(const std::string& s) {
-            auto& set = nullable;
-            size_t count = _addToSet(set, s);
-            return count;
-        }
+        /// @brief mark all nullable rulesets
+        /// each rule counts its nodes that are not yet known to be nullable,
+        /// when the count drops to 0, the rule's ruleset becomes nullable
+        /// and is queued to update the rules that use it
+        inline void buildNullable() {
+            std::vector<size_t> pending(grammar.rules.size(), 0);
+            std::vector<std::vector<size_t>> users(nullable.size());
+            std::vector<size_t> worklist;
+
+            for(size_t ridx = 0; ridx < grammar.rules.size(); ++ridx) {
+                auto& rule = *(grammar.rules.at(ridx));
+                bool possible = true;
+                for(auto& n : rule.nodes) {
+                    if(n->isRule() == true) {
+                        users.at(n->symbolId).push_back(ridx);
+                        ++pending.at(ridx);
+                    }else if(isNullable(*n) == false) {
+                        possible = false;
+                    }
+                }
 
-        inline size_t addFirst(const std::string& r, const std::string& s) {
-            auto& set = firsts[r];
-            size_t count = _addToSet(set, s);
-            return count;
-        }
+                if(possible == false) {
+                    // never reaches 0
+                    pending.at(ridx) = rule.nodes.size() + 1;
+                    continue;
+                }
 
-        inline size_t addFollow(const std::string& r, const std::string& s) {
-            auto& set = follows[r];
-            size_t count = _addToSet(set, s);
-            return count;
-        }
+                if(pending.at(ridx) == 0) {
+                    auto rsid = grammar.getSymbolId(*(rule.ruleSet));
+                    if(nullable.at(rsid) == false) {
+                        nullable.at(rsid) = true;
+                        worklist.push_back(rsid);
+                    }
+                }
+            }
 
-        inline size_t appendFirsts(const std::string& dst, const std::string& src) {
-            auto& sset = firsts[src];
-            size_t count = 0;
-            for(auto& s : sset) {
-                count += addFirst(dst, s);
+            while(worklist.size() > 0) {
+                auto sid = worklist.back();
+                worklist.pop_back();
+                for(auto& ridx : users.at(sid)) {
+                    if(pending.at(ridx) == 0) {
+                        continue;
+                    }
+                    if(--pending.at(ridx) > 0) {
+                        continue;
+                    }
+                    auto& rule = *(grammar.rules.at(ridx));
+                    auto rsid = grammar.getSymbolId(*(rule.ruleSet));
+                    if(nullable.at(rsid) == false) {
+                        nullable.at(rsid) = true;
+                        worklist.push_back(rsid);
+                    }
+                }
             }
-            return count;
         }
 
-        inline size_t appendFirstsToFollows(const std::string& dst, const std::string& src) {
-            auto& sset = firsts[src];
-            size_t count = 0;
-            for(auto& s : sset) {
-                count += addFollow(dst, s);
+        /// @brief compute the FIRST-SET of all symbols
+        /// FIRST(a) contains FIRST(b), if 'b' is preceded only by nullable nodes in any of the rules for 'a'
+        inline void buildFirsts() {
+            for(auto& rxs : grammar.regexSets) {
+                auto sid = grammar.getSymbolId(*rxs);
+                firsts.at(sid).set(sid);
             }
-            return count;
-        }
 
-        inline size_t appendFollows(const std::string& dst, const std::string& src) {
-            auto& sset = follows[src];
-            size_t count = 0;
-            for(auto& s : sset) {
-                count += addFollow(dst, s);
+            std::vector<std::vector<size_t>> edges(firsts.size());
+            for(auto& r : grammar.rules) {
+                auto& rule = *r;
+                auto rsid = grammar.getSymbolId(*(rule.ruleSet));
+                for(size_t i = 0; i < rule.nodes.size(); ++i) {
+                    auto& n1 = rule.getNode(i);
+                    if((i == 0) || (n1.symbolId != rsid)) {
+                        edges.at(n1.symbolId).push_back(rsid);
+                    }
+                    if(isNullable(n1) == false) {
+                        break;
+                    }
+                }
             }
-            return count;
-        }
-    };
 
-    inline void buildLinks() {
-        Links links(grammar);
-        for(auto& rxs : grammar.regexSets) {
-            links.addFirst(rxs->name, rxs->name);
+            propagate(firsts, edges);
         }
 
-        // RULE 1: follow(a) contains END, if 'a' is a start symbol
-        for(auto& r : grammar.rules) {
-            auto& rule = *r;
-            if(rule.ruleSetName() == grammar.start) {
-                links.addFollow(rule.ruleSetName(), grammar.end);
+        /// @brief compute the FOLLOW-SET of all symbols
+        /// must be called after buildFirsts()
+        inline void buildFollows() {
+            // RULE 1: follow(a) contains END, if 'a' is a start symbol
+            if((grammar.startRuleSet != nullptr) && (grammar.endRegexSet != nullptr)) {
+                follows.at(grammar.getSymbolId(*(grammar.startRuleSet))).set(grammar.getSymbolId(*(grammar.endRegexSet)));
             }
-        }
 
-        size_t changes = 0;
-        do {
-            changes = 0;
+            std::vector<std::vector<size_t>> edges(follows.size());
+            std::vector<bool> tailNullable;
             for(auto& r : grammar.rules) {
                 auto& rule = *r;
+                auto rsid = grammar.getSymbolId(*(rule.ruleSet));
 
                 size_t k = rule.nodes.size();
                 assert(k > 0);
 
-                for(auto& r2 : grammar.rules) {
-                    for(size_t idx = 0; idx < r2->nodes.size() - 1; ++idx) {
-                        auto& n1 = r2->getNode(idx);
-                        if(n1.name != rule.ruleSetName()) {
-                            continue;
-                        }
-
-                        auto& n2 = r2->getNode(idx + 1);
-                        if(n2.isRule() == true) {
-                            // RULE 2: follow(a) contains first(b), if 'b' is immediately after 'a' in any of the rules
-                            changes += links.appendFirstsToFollows(rule.ruleSetName(), n2.name);
-                        }else{
-                            // RULE 3: follow(a) contains REGEX1, if REGEX1 is immediately after 'a' in any of the rules
-                            assert(n2.isRegex() == true);
-                            changes += links.addFollow(rule.ruleSetName(), n2.name);
-                        }
+                // RULE 2: follow(a) contains first(b), if 'b' is immediately after 'a' in any of the rules
+                // RULE 3: follow(a) contains REGEX1, if REGEX1 is immediately after 'a' in any of the rules
+                for(size_t i = 0; i < (k - 1); ++i) {
+                    auto& n1 = rule.getNode(i);
+                    if(n1.isRule() == false) {
+                        continue;
                     }
-                }
-
-                if(links.isRuleNullable(rule, 0, k) == true) {
-                    changes += links.addNullable(rule.ruleSetName());
-                }
-
-                auto& n0 = rule.getNode(0);
-                if(n0.isRule() == true) {
-                    changes += links.appendFirsts(rule.ruleSetName(), n0.name);
-                }else{
-                    assert(n0.isRegex() == true);
-                    changes += links.addFirst(rule.ruleSetName(), n0.name);
+                    auto& n2 = rule.getNode(i + 1);
+                    follows.at(n1.symbolId).merge(firsts.at(n2.symbolId));
                 }
 
                 // RULE 4: follow(b) contains follow(a), if 'b' is the last node in any of the rules for 'a'
                 auto& nx = rule.getNode(k - 1);
-                if(nx.isRule() == true) {
-                    for(auto& r2 : grammar.rules) {
-                        auto& rule2 = *r2;
-                        if(rule2.ruleName == nx.name) {
-                            changes += links.appendFollows(nx.name, rule2.ruleName);
-                        }
+                edges.at(rsid).push_back(nx.symbolId);
+
+                // tailNullable[i] is true if all nodes after i are nullable
+                tailNullable.assign(k, false);
+                for(size_t i = k - 1; i > 0; --i) {
+                    auto& n2 = rule.getNode(i);
+                    if(isNullable(n2) == false) {
+                        break;
                     }
+                    tailNullable.at(i - 1) = true;
                 }
 
-                changes += links.appendFollows(nx.name, rule.ruleSetName());
-
-                for(size_t i = 0; i < k; ++i) {
+                for(size_t i = 0; i < (k - 1); ++i) {
                     auto& n1 = rule.getNode(i);
-                    if(n1.name == rule.ruleSetName()) {
+                    if(n1.symbolId == rsid) {
                         continue;
                     }
 
-                    if(i < (k - 1)) {
-                        auto& n2 = rule.getNode(i+1);
-                        if(links.isNullable(n2) == true) {
-                            changes += links.appendFollows(n1.name, n2.name);
-                        }
-                    }
-
-                    if(links.isRuleNullable(rule, 0, i) == true) {
-                        changes += links.appendFirsts(rule.ruleSetName(), n1.name);
+                    auto& n2 = rule.getNode(i+1);
+                    if(isNullable(n2) == true) {
+                        edges.at(n2.symbolId).push_back(n1.symbolId);
                     }
 
-                    if((i < k) && (links.isRuleNullable(rule, i+1, k) == true)) {
-                        changes += links.appendFollows(rule.ruleSetName(), n1.name);
+                    if(tailNullable.at(i) == true) {
+                        edges.at(n1.symbolId).push_back(rsid);
                     }
                 }
             }
-        }while(changes > 0);
 
-        for(auto& rs : grammar.ruleSets) {
-            assert(rs->rules.size() > 0);
-            auto& r0 = *(rs->rules.at(0));
+            propagate(follows, edges);
+        }
+    };
 
-            assert(rs->firsts.size() == 0);
-            for(auto& ss : links.firsts) {
-                if(ss.first != rs->name) {
-                    continue;
-                }
-                for(auto& s : ss.second) {
-                    auto& rx = grammar.getRegexSetByName(r0.pos, s);
-                    rs->firsts.push_back(&rx);
-                }
-            }
+    /// @brief convert a set of tokenset ids into a list of tokensets
+    /// the list is kept in name order, so that the generated output
+    /// does not depend on the order in which tokens are defined
+    inline void setTokenList(std::vector<yglx::RegexSet*>& list, const TokenBits& set) const {
+        assert(list.size() == 0);
+        set.forEach([&](const size_t& s) {
+            assert(grammar.isRegexSymbol(s) == true);
+            list.push_back(grammar.regexSets.at(s).get());
+        });
+        std::ranges::sort(list, [](const yglx::RegexSet* lhs, const yglx::RegexSet* rhs) {
+            return lhs->name < rhs->name;
+        });
+    }
 
-            assert(rs->follows.size() == 0);
-            for(auto& ss : links.follows) {
-                if(ss.first != rs->name) {
-                    continue;
-                }
-                for(auto& s : ss.second) {
-                    auto& rx = grammar.getRegexSetByName(r0.pos, s);
-                    rs->follows.push_back(&rx);
-                }
-            }
+    inline void buildLinks() {
+        Links links(grammar);
+        links.buildNullable();
+        links.buildFirsts();
+        links.buildFollows();
+
+        for(auto& rs : grammar.ruleSets) {
+            assert(rs->rules.size() > 0);
+            auto sid = grammar.getSymbolId(*rs);
+            setTokenList(rs->firsts, links.firsts.at(sid));
+            setTokenList(rs->follows, links.follows.at(sid));
         }
     }
 
@@ -859,10 +1269,9 @@ struct ParserStateMachineBuilder {
                 auto& rx = grammar.getRegexSet(anchor);
                 r->precedence = &rx;
             }else if(anchor.isRule()) {
-                auto& rs = grammar.getRuleSetByName(anchor.pos, anchor.name);
+                auto& rs = grammar.getRuleSet(anchor);
                 assert(rs.firsts.size() > 0);
-                auto& rx = grammar.getRegexSetByName(anchor.pos, rs.firsts.at(0)->name);
-                r->precedence = &rx;
+                r->precedence = rs.firsts.at(0);
             }
         }
 
@@ -870,10 +1279,10 @@ struct ParserStateMachineBuilder {
 
         // create Parser State Machine
         std::vector<const ygp::Config*> configs;
-        for(auto& rule : grammar.rules) {
-            if(rule->ruleSetName() == grammar.start) {
-                if(!hasRuleInConfigList(configs, *rule)) {
-                    auto& ccfg = grammar.createConfig(*rule, 0);
+        if(grammar.startRuleSet != nullptr) {
+            for(auto& rule : grammar.startRuleSet->rules) {
+                auto& ccfg = grammar.createConfig(*rule, 0);
+                if(!hasConfigInList(configs, ccfg)) {
                     configs.push_back(&ccfg);
                 }
             }
@@ -884,8 +1293,10 @@ struct ParserStateMachineBuilder {
         }
 
         auto& sis = createItemSet(configs, "");
+        buildLookaheads(sis);
         log("linking");
         linkItemSets();
+        pruneItemSets(sis);
 
         grammar.initialState = &sis;
     }
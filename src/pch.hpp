@@ -5,12 +5,18 @@
 #include <sstream>
 #include <filesystem>
 #include <format>
+#include <map>
 #include <unordered_map>
 #include <vector>
 #include <variant>
 #include <set>
 #include <unordered_set>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <memory>
 #include <ranges>
 #include <assert.h>
 #include <algorithm>
+#include <bit>
@@ -19,6 +19,12 @@
 /// In case of REDUCE, it adds the approrpiate nodes to the AST
 ///
 /// Once the Parser is done, the correct Walker is called to walk the AST and invoke the semantic action blocks.
+///
+/// When generating separate translation units, the part of this file up to the
+/// Impl class goes into a private header, and each PROTOTYPE_TARGET after it
+/// starts a new .cpp file that includes that header.
+/// The anonymous namespaces then become a named namespace (IMPLNS), and the
+/// functions defined in the separate units are no longer inline (INLINE).
 
 ///PROTOTYPE_ENTER:SKIP
 #include <stdint.h>
@@ -42,6 +48,14 @@ constexpr unsigned long ROW = 1;
 constexpr unsigned long COL = 1;
 constexpr const char* SRC = "";
 constexpr const char* MSG = "";
+constexpr size_t LEXER_STATE_COUNT = 1;
+constexpr size_t PARSER_STATE_COUNT = 1;
+constexpr size_t RULE_COUNT = 1;
+constexpr size_t TOKEN_COUNT = 1;
+constexpr bool UNIT_SEPARATOR_IN_UNIT = true;
+
+#define INLINE inline
+#define IMPLNAME IMPLNS
 
 ///PROTOTYPE_LEAVE:SKIP
 
@@ -57,11 +71,23 @@ constexpr const char* MSG = "";
 #include <filesystem>
 #include <functional>
 #include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <bit>
+#include <optional>
+///PROTOTYPE_ENTER:IF_CAPTURE
+#include <thread>
+///PROTOTYPE_LEAVE:IF_CAPTURE
 #include <assert.h>
 ///PROTOTYPE_LEAVE:stdHeaders
 
 ///PROTOTYPE_SEGMENT:hdrHeaders
 
+// compile with -DHAS_PROFILER=1 to fill in the module's stats
+#if !defined(HAS_PROFILER)
+#define HAS_PROFILER 0
+#endif
+
 ///PROTOTYPE_ENTER:IF_HAS_NS
 namespace TAG(NSNAME) {
 ///PROTOTYPE_LEAVE:IF_HAS_NS
@@ -99,9 +125,73 @@ struct TAG(CLSNAME) {
         {}
     };
 
+    /// @brief time and counts for each phase, accumulated over all streams read by this module
+    /// Only filled in when compiled with HAS_PROFILER=1
+    struct Stats {
+        struct Walk {
+            std::string name;
+            size_t calls = 0;
+            uint64_t ns = 0;
+        };
+
+        /// @brief adds the time from construction to destruction to @arg ns
+        struct Timer {
+            uint64_t& ns;
+            std::chrono::steady_clock::time_point start;
+            inline explicit Timer(uint64_t& n) : ns(n), start(std::chrono::steady_clock::now()) {}
+            inline Timer(const Timer&) = delete;
+            inline Timer(Timer&&) = delete;
+            inline Timer& operator=(const Timer&) = delete;
+            inline Timer& operator=(Timer&&) = delete;
+            inline ~Timer() {
+                ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            }
+        };
+
+        /// @brief tokens sent by the lexer to the parser
+        size_t tokens = 0;
+        size_t shifts = 0;
+        size_t reduces = 0;
+        size_t astNodes = 0;
+
+        /// @brief time spent in readStream(), which includes parseNS since the lexer calls the parser
+        uint64_t readNS = 0;
+        uint64_t parseNS = 0;
+        uint64_t astNS = 0;
+        std::vector<Walk> walks;
+
+        inline auto lexNS() const -> uint64_t {
+            return (readNS > parseNS) ? (readNS - parseNS) : 0;
+        }
+
+        inline auto walk(const std::string& n) -> Walk& {
+            for(auto& w : walks) {
+                if(w.name == n) {
+                    return w;
+                }
+            }
+            walks.push_back(Walk{n, 0, 0});
+            return walks.back();
+        }
+
+        inline void print(std::ostream& os) const {
+            static constexpr double nsPerMS = 1000000.0;
+            os << std::format("{:<16} {:>12} {:>12}\n", "phase", "ms", "count");
+            os << std::format("{:<16} {:>12.3f} {:>12}\n", "lexer", static_cast<double>(lexNS()) / nsPerMS, tokens);
+            os << std::format("{:<16} {:>12.3f} {:>12}\n", "parser", static_cast<double>(parseNS) / nsPerMS, shifts + reduces);
+            os << std::format("{:<16} {:>12} {:>12}\n", "  shifts", "", shifts);
+            os << std::format("{:<16} {:>12} {:>12}\n", "  reduces", "", reduces);
+            os << std::format("{:<16} {:>12.3f} {:>12}\n", "ast", static_cast<double>(astNS) / nsPerMS, astNodes);
+            for(const auto& w : walks) {
+                os << std::format("{:<16} {:>12.3f} {:>12}\n", "walk_" + w.name, static_cast<double>(w.ns) / nsPerMS, w.calls);
+            }
+        }
+    };
+
     struct Impl;
     std::unique_ptr<Impl> _impl;
     std::string name;
+    Stats stats;
 
     ///PROTOTYPE_SEGMENT:classMembers
 
@@ -109,7 +199,57 @@ struct TAG(CLSNAME) {
     ~TAG(CLSNAME)();
 
     void beginStream();
+
+    // number of top-level items that the parser completed since the last call or the start of the stream,
+    // such as to report the progress of a stream read by readChunk(), whose AST is only built by endStream()
+    // a top-level item is a value added to a rule of the start ruleset, such as each stmt of `start := stmts;`
+    // when stmts is a left-recursive list, `stmts := stmts stmt;`
+    size_t completedItems();
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    /// @brief a change to the document read by readDocument(), such as one typed in an editor
+    struct Edit {
+        // byte offset of the change, in the document as left by the edits before it
+        size_t offset = 0;
+
+        // number of bytes replaced by @ref text
+        size_t length = 0;
+
+        std::string text;
+    };
+
+    // the document read by readDocument(), with the edits passed to updateDocument()
+    const std::string& document() const;
+
+    /// @brief the state of the lexer and parser in the stream being read, taken by snapshot() and resumed by restore()
+    /// A snapshot taken between two readChunk() calls, possibly in the middle of a token, lets the stream be read again
+    /// from there, such as from the start of a line changed in an editor, instead of from the start of the stream.
+    /// It is valid until another stream is read, or until the stream is restored to an earlier point and read past it.
+    /// readChunk() takes no snapshots by itself, unlike the checkpoints that readDocument() takes every few lines.
+    class Snapshot {
+    public:
+        struct Data;
+
+    private:
+        friend struct TAG(CLSNAME);
+        std::shared_ptr<const Data> _d;
+    };
+
+    Snapshot snapshot() const;
+
+    // continue the stream from @arg s, the next readChunk() passes the input after the point where it was taken
+    // throws if the parser values of the snapshot have been overwritten since
+    // this starts a new AST generation, so after reuseAst(true) the AST read before it is invalid unless held
+    void restore(const Snapshot& s);
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+    ///PROTOTYPE_ENTER:IF_THROW
     void readStream(std::istream& is, const std::string_view& filename);
+
+    // read the next chunk of a stream as it arrives, such as from a socket, without blocking
+    // the lexer stops at the end of each chunk and continues with the next one, until endStream()
+    void readChunk(const std::string_view& chunk, const std::string_view& filename);
+
     void endStream();
 
     // read file into AST
@@ -118,10 +258,188 @@ struct TAG(CLSNAME) {
     // read string into AST
     void readString(const std::string& s, const std::string_view& filename);
 
+    ///PROTOTYPE_ENTER:IF_PARALLEL
+    // read a large input held in memory into AST, lexing its chunks speculatively on up to @arg threads threads
+    // 0 uses one thread per core, the tokens are parsed in order on the calling thread
+    void readParallel(const std::string_view& input, const std::string_view& filename, const size_t& threads = 0);
+    ///PROTOTYPE_LEAVE:IF_PARALLEL
+
+    ///PROTOTYPE_ENTER:IF_UNITS
+    // read an input held in memory into AST, parsing the units between the separators set by %parallel_units on up to @arg threads threads
+    // 0 uses one thread per core, the units are joined in order on the calling thread
+    void readUnits(const std::string_view& input, const std::string_view& filename, const size_t& threads = 0);
+    ///PROTOTYPE_LEAVE:IF_UNITS
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    // read a document that is edited later into AST, keeping a copy of it with its tokens for updateDocument()
+    void readDocument(const std::string_view& text, const std::string_view& filename);
+
+    // apply @arg edits to the document in order and read it again into AST, resuming from the last checkpoint before them
+    // only the tokens around the edits are lexed again, but the parser parses all the tokens after the checkpoint,
+    // and the whole AST is built again, no subtree of the old parse tree after the checkpoint is reused
+    void updateDocument(const std::vector<Edit>& edits);
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+    ///PROTOTYPE_LEAVE:IF_THROW
+
+    ///PROTOTYPE_ENTER:IF_RESULT
+    /// @brief lexer or parser error, returned by the read functions of a module generated with ycc -e
+    /// Only the position and the offending token are recorded, the message is formatted by msg()
+    struct Failure {
+        enum class Code : uint8_t {
+            File = 1,
+            Token,
+            Syntax,
+        };
+        Code code = Code::Syntax;
+        size_t row = 0;
+        size_t col = 0;
+        std::string file;
+
+        // id of the received token, for Code::Syntax
+        size_t token = 0;
+
+        // text of the offending token, or the name of the file for Code::File
+        std::string text;
+
+        // tokens expected by the parser, for Code::Syntax
+        std::string_view expected;
+
+        // the same message as the exception thrown by a module generated without -e
+        std::string msg() const;
+    };
+
+    /// @brief result of a read, in the style of std::expected<void, Failure>
+    /// The failure is owned by the module, and is valid until the next stream is read
+    class [[nodiscard]] Result {
+        const Failure* _f = nullptr;
+    public:
+        inline Result() = default;
+        inline explicit Result(const Failure& f) : _f(&f) {}
+
+        inline bool has_value() const {
+            return (_f == nullptr);
+        }
+
+        inline explicit operator bool() const {
+            return has_value();
+        }
+
+        inline const Failure& error() const {
+            return *_f;
+        }
+    };
+
+    ///PROTOTYPE_ENTER:SKIP
+    // the prototype itself is compiled with the IF_THROW variant
+    #if 0
+    ///PROTOTYPE_LEAVE:SKIP
+    // after a failure, further reads of the same stream return it without reading
+    Result readStream(std::istream& is, const std::string_view& filename);
+
+    // read the next chunk of a stream as it arrives, such as from a socket, without blocking
+    // the lexer stops at the end of each chunk and continues with the next one, until endStream()
+    Result readChunk(const std::string_view& chunk, const std::string_view& filename);
+
+    Result endStream();
+
+    // read file into AST
+    Result readFile(const std::string& filename);
+
+    // read string into AST
+    Result readString(const std::string& s, const std::string_view& filename);
+
+    ///PROTOTYPE_ENTER:IF_PARALLEL
+    // read a large input held in memory into AST, lexing its chunks speculatively on up to @arg threads threads
+    // 0 uses one thread per core, the tokens are parsed in order on the calling thread
+    Result readParallel(const std::string_view& input, const std::string_view& filename, const size_t& threads = 0);
+    ///PROTOTYPE_LEAVE:IF_PARALLEL
+
+    ///PROTOTYPE_ENTER:IF_UNITS
+    // read an input held in memory into AST, parsing the units between the separators set by %parallel_units on up to @arg threads threads
+    // 0 uses one thread per core, the units are joined in order on the calling thread
+    Result readUnits(const std::string_view& input, const std::string_view& filename, const size_t& threads = 0);
+    ///PROTOTYPE_LEAVE:IF_UNITS
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    // read a document that is edited later into AST, keeping a copy of it with its tokens for updateDocument()
+    Result readDocument(const std::string_view& text, const std::string_view& filename);
+
+    // apply @arg edits to the document in order and read it again into AST, resuming from the last checkpoint before them
+    // only the tokens around the edits are lexed again, but the parser parses all the tokens after the checkpoint,
+    // and the whole AST is built again, no subtree of the old parse tree after the checkpoint is reused
+    Result updateDocument(const std::vector<Edit>& edits);
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+    ///PROTOTYPE_ENTER:SKIP
+    #endif
+    ///PROTOTYPE_LEAVE:SKIP
+    ///PROTOTYPE_LEAVE:IF_RESULT
+
+    // discard the AST and parser state, keeping the allocated memory for the next stream
+    // references to AST nodes from earlier streams are invalid after this
+    void reset();
+
+    // reuse the AST nodes of earlier streams for each new stream, off by default
+    // when off, each stream adds to the AST, and the nodes of earlier streams stay valid until reset()
+    void reuseAst(const bool& on);
+
+    /// @brief keeps the AST of the most recent stream alive while it is held
+    /// Each stream read into the module starts a new AST generation. After reuseAst(true),
+    /// the nodes of earlier generations are reused by it unless a Hold is alive for them.
+    class Hold {
+        TAG(CLSNAME)* _m = nullptr;
+        uint64_t _gen = 0;
+        friend struct TAG(CLSNAME);
+        inline Hold(TAG(CLSNAME)& m, const uint64_t& gen) : _m(&m), _gen(gen) {}
+    public:
+        inline Hold(const Hold&) = delete;
+        inline Hold& operator=(const Hold&) = delete;
+        inline Hold(Hold&& o) noexcept : _m(o._m), _gen(o._gen) {
+            o._m = nullptr;
+        }
+        inline Hold& operator=(Hold&& o) noexcept {
+            if(this != &o) {
+                if(_m != nullptr) {
+                    _m->release(_gen);
+                }
+                _m = o._m;
+                _gen = o._gen;
+                o._m = nullptr;
+            }
+            return *this;
+        }
+        inline ~Hold() {
+            if(_m != nullptr) {
+                _m->release(_gen);
+            }
+        }
+    };
+
+    // hold the AST of the most recent stream, so that references into it stay valid
+    // while further streams are read
+    [[nodiscard]] Hold hold();
+
+private:
+    void release(const uint64_t& gen);
+
+public:
+
     ///PROTOTYPE_SEGMENT:walkerCallDecls
 
     // print AST
     void printAST(std::ostream& ss, const size_t& lvl, const std::string& indent) const;
+
+    // log stream of this module, selected by the logger passed to the constructor
+    std::ostream& log() const;
+
+    ///PROTOTYPE_ENTER:IF_HOTSPOTS
+    // write the lexer state, parser state and rule counters
+    void dumpHotspots(std::ostream& os) const;
+    ///PROTOTYPE_LEAVE:IF_HOTSPOTS
+
+    ///PROTOTYPE_ENTER:IF_TRACE
+    // write the most recent lexer and parser steps as a binary trace
+    void dumpTrace(std::ostream& os) const;
+    ///PROTOTYPE_LEAVE:IF_TRACE
 };
 ///PROTOTYPE_ENTER:IF_HAS_NS
 }
@@ -153,18 +471,16 @@ throw TAG(Q_NSNAME)TAG(CLSNAME)::Error(TAG(ROW), TAG(COL), TAG(SRC), TAG(MSG));
 #pragma GCC diagnostic ignored "-Wsubobject-linkage"
 #endif
 
+///PROTOTYPE_ENTER:IF_SPLIT
+namespace TAG(IMPLNAME) {}
+using namespace TAG(IMPLNAME);
+///PROTOTYPE_LEAVE:IF_SPLIT
+
 ///PROTOTYPE_INCLUDE:print
 
-namespace {
+namespace TAG(IMPLNS){
     ///PROTOTYPE_INCLUDE:nsutil
     ///PROTOTYPE_INCLUDE:textWriter
-
-    static std::ostream* _log = nullptr;
-
-    inline std::ostream& log() {
-        assert(_log != nullptr);
-        return *_log;
-    }
 }
 
 ///PROTOTYPE_ENTER:astNodeDeclsBlock
@@ -241,7 +557,7 @@ namespace TAG(Q_NSNAME)TAG2(CLSNAME,_AST) {
 }
 ///PROTOTYPE_LEAVE:SKIP
 
-namespace {
+namespace TAG(IMPLNS){
     struct _astEmpty {
         inline void dump(std::ostream&, const size_t&, const FilePos&, const std::string&, const size_t&) const {
         }
@@ -252,7 +568,7 @@ namespace TAG(Q_NSNAME)TAG2(CLSNAME,_AST) {
     ///PROTOTYPE_SEGMENT:astNodeDefns
 }
 
-namespace {
+namespace TAG(IMPLNS){
     ///PROTOTYPE_ENTER:SKIP
     using AstNode = std::variant <
     TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)
@@ -272,10 +588,62 @@ namespace {
 
         std::vector<std::unique_ptr<AstNode>> astNodes;
 
+        // number of astNodes in use, the nodes after it are kept for reuse by the next generation
+        size_t astNodeCount = 0;
+
+        // each stream starts a new generation of nodes
+        // if recycle is set, a held generation pins the nodes up to its end, and everything after that is reused
+        struct Generation {
+            uint64_t id = 0;
+            size_t end = 0;
+            size_t holds = 0;
+        };
+        uint64_t generation = 0;
+        std::vector<Generation> pinned;
+        bool recycle = false;
+
+        inline void begin() {
+            if((pinned.size() > 0) && (pinned.back().id == generation)) {
+                pinned.back().end = astNodeCount;
+            }
+            if(recycle == true) {
+                astNodeCount = (pinned.size() > 0) ? pinned.back().end : 0;
+            }
+            R_start = nullptr;
+            ++generation;
+        }
+
+        inline void hold() {
+            if((pinned.size() == 0) || (pinned.back().id != generation)) {
+                pinned.push_back(Generation{generation, astNodeCount, 0});
+            }
+            ++pinned.back().holds;
+        }
+
+        inline void release(const uint64_t& gen) {
+            auto it = std::find_if(pinned.begin(), pinned.end(), [&gen](const Generation& g){ return g.id == gen; });
+            assert(it != pinned.end());
+            if(--(it->holds) == 0) {
+                pinned.erase(it);
+            }
+        }
+
+        inline AstNode& nextAstNode() {
+            if(astNodeCount == astNodes.size()) {
+                astNodes.push_back(std::make_unique<AstNode>());
+            }
+            return *(astNodes.at(astNodeCount++));
+        }
+
         inline TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)& createToken(const FilePos& p, const std::string& text) {
-            astNodes.push_back(std::make_unique<AstNode>(TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)(p, text)));
-            AstNode& ri = *(astNodes.back());
-            return std::get<TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)>(ri);
+            AstNode& ri = nextAstNode();
+            // reuse the text buffer of a token left by an earlier stream
+            if(auto* t = std::get_if<TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)>(&ri)) {
+                t->pos = p;
+                t->text = text;
+                return *t;
+            }
+            return ri.emplace<TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)>(p, text);
         }
 
         template<typename AstNodeT>
@@ -283,17 +651,25 @@ namespace {
         [[maybe_unused]]
         ///PROTOTYPE_LEAVE:SKIP
         inline AstNodeT& createAstNode(const FilePos& p, const TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(TOKEN)& anchor) {
-            auto w = std::make_unique<AstNode>();
-            astNodes.push_back(std::move(w));
-            AstNode& astNode = *(astNodes.back());
+            AstNode& astNode = nextAstNode();
             astNode.emplace<AstNodeT>(p, anchor);
             return std::get<AstNodeT>(astNode);
         }
 
         TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(START_RULE)* R_start = nullptr;
 
+        inline void reset() {
+            if(pinned.size() > 0) {
+                throw std::runtime_error("Cannot reset while AST is held");
+            }
+            astNodeCount = 0;
+            R_start = nullptr;
+        }
+
         inline TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(START_RULE)& _root() const {
-            assert(R_start);
+            if(R_start == nullptr) {
+                throw std::runtime_error("No AST");
+            }
             return *(R_start);
         }
     }; // TAG(AST)
@@ -323,11 +699,11 @@ namespace {
 
 ///PROTOTYPE_SEGMENT:walkers
 
-namespace {
+namespace TAG(IMPLNS){
     ///PROTOTYPE_SEGMENT:epilogue
 } // namespace
 
-namespace {
+namespace TAG(IMPLNS){
 [[maybe_unused]]
 constexpr size_t MaxRepeatCount = TAG(MAX_REPEAT_COUNT);
 
@@ -401,6 +777,9 @@ struct Stream {
         static char_t ch = ' ';
         return ch;
     }
+
+    inline void setPartial(const bool&) {}
+    inline void resume() {}
 };
 ///PROTOTYPE_LEAVE:SKIP
 
@@ -409,6 +788,9 @@ struct Tolkien {
         _null = 0,
         ///PROTOTYPE_ENTER:SKIP
         _tEND,
+        _tEMPTY,
+        UNIT_RULE,
+        UNIT_SEPARATOR,
         ///PROTOTYPE_LEAVE:SKIP
         ///PROTOTYPE_SEGMENT:tokenIDs
     };
@@ -420,6 +802,13 @@ struct Tolkien {
     inline Tolkien() {}
     inline Tolkien(const FilePos& p) : pos(p) {}
 
+    // start a new token at @arg p, keeping the capacity of text
+    inline void reset(const FilePos& p) {
+        pos = p;
+        text.clear();
+        id = ID::_null;
+    }
+
     static inline std::string str(const ID& i) {
         static const std::unordered_map<ID, std::string> tnames = {
             {ID::_null, "_null"},
@@ -441,6 +830,77 @@ struct Tolkien {
     }
 };
 
+///PROTOTYPE_ENTER:IF_HOTSPOTS
+/// @brief counts how often each lexer state, parser state and rule is visited
+/// generated by ycc -p, and written by dump() in the format read by ycc -P
+struct Hotspots {
+    struct TokenStat {
+        uint64_t count = 0;
+        uint64_t bytes = 0;
+        size_t maxLen = 0;
+    };
+
+    std::vector<uint64_t> lexerStates = std::vector<uint64_t>(TAG(LEXER_STATE_COUNT), 0);
+    std::vector<uint64_t> parserStates = std::vector<uint64_t>(TAG(PARSER_STATE_COUNT), 0);
+    std::vector<uint64_t> rules = std::vector<uint64_t>(TAG(RULE_COUNT), 0);
+    std::vector<TokenStat> tokens = std::vector<TokenStat>(TAG(TOKEN_COUNT));
+    uint64_t epsilonShifts = 0;
+
+    inline void addToken(const Tolkien& k) {
+        auto& ts = tokens.at(static_cast<size_t>(k.id));
+        ++ts.count;
+        ts.bytes += k.text.size();
+        ts.maxLen = std::max(ts.maxLen, k.text.size());
+    }
+
+    TAG(INLINE)void dump(std::ostream& os) const;
+};
+///PROTOTYPE_LEAVE:IF_HOTSPOTS
+
+///PROTOTYPE_ENTER:IF_TRACE
+// compile with -DTRACE_RECORDS=<n> to change the size of the trace ring buffer
+#if !defined(TRACE_RECORDS)
+#define TRACE_RECORDS 65536
+#endif
+
+/// @brief keeps the most recent lexer and parser steps as fixed-size binary records
+/// generated by ycc -j +trace, written by dump() and decoded by ycc -T
+struct Trace {
+    enum class Kind : uint16_t {
+        Lexer = 1,
+        Token = 2,
+        Shift = 3,
+        Reduce = 4,
+        Goto = 5,
+    };
+
+    struct Record {
+        Kind kind;
+        uint16_t col;
+        uint32_t row;
+        uint32_t state;
+        uint32_t value;
+    };
+    static_assert(sizeof(Record) == 16);
+    static_assert(std::has_single_bit(static_cast<size_t>(TRACE_RECORDS)), "TRACE_RECORDS must be a power of 2");
+
+    std::vector<Record> records = std::vector<Record>(TRACE_RECORDS);
+    uint64_t next = 0;
+
+    inline void add(const Kind& kind, const size_t& state, const uint32_t& value, const FilePos& pos) {
+        auto& r = records[next & (records.size() - 1)];
+        r.kind = kind;
+        r.col = static_cast<uint16_t>(std::min<size_t>(pos.col, UINT16_MAX));
+        r.row = static_cast<uint32_t>(std::min<size_t>(pos.row, UINT32_MAX));
+        r.state = static_cast<uint32_t>(state);
+        r.value = value;
+        ++next;
+    }
+
+    TAG(INLINE)void dump(std::ostream& os) const;
+};
+///PROTOTYPE_LEAVE:IF_TRACE
+
 struct Parser {
     struct ValueItem {
         Tolkien token;
@@ -455,17 +915,50 @@ struct Parser {
 
     TAG(AST)& ast;
     std::vector<std::unique_ptr<ValueItem>> values;
+
+    // number of values in use, the values after it are kept for reuse by the next stream
+    size_t valueCount = 0;
+
+    // the symbol being matched in parse(), kept here to reuse its text buffer
+    Tolkien lookahead;
     std::vector<ValueItem*> valueStack;
     std::vector<size_t> stateStack;
 
+    // number of values added to a rule of the start ruleset, counted by the GOTOs after them
+    size_t items = 0;
+    ///PROTOTYPE_ENTER:IF_HOTSPOTS
+    Hotspots hotspots;
+    ///PROTOTYPE_LEAVE:IF_HOTSPOTS
+    ///PROTOTYPE_ENTER:IF_TRACE
+    Trace trace;
+    ///PROTOTYPE_LEAVE:IF_TRACE
+
+    inline ValueItem& nextValue() {
+        if(valueCount == values.size()) {
+            values.push_back(std::make_unique<ValueItem>(Tolkien()));
+        }
+        auto& vi = *(values.at(valueCount++));
+        vi.ruleID = 0;
+        vi.childs.clear();
+        return vi;
+    }
+
     inline ValueItem& addValue(const Tolkien& t) {
-        values.push_back(std::make_unique<ValueItem>(t));
-        return *(values.back());
+        auto& vi = nextValue();
+        vi.token = t;
+        return vi;
     }
 
     inline Parser(TAG(AST)& a) : ast(a) {}
 
+    inline std::ostream& log() const {
+        return ast.pub.log();
+    }
+
     inline ValueItem& shift(const Tolkien& k) {
+#if HAS_PROFILER
+        ++ast.pub.stats.shifts;
+#endif
         auto& vi = addValue(k);
         valueStack.push_back(&vi);
         return vi;
@@ -477,41 +970,45 @@ struct Parser {
         return shift(token);
     }
 
-    inline Tolkien _reduce(const size_t& len, const size_t& anchor, std::vector<ValueItem*>& childs) {
+    // pops @arg len values into the childs of @arg vi, which takes the position of the anchor value
+    inline void _reduce(const size_t& len, const size_t& anchor, ValueItem& vi) {
         assert(valueStack.size() >= len);
         assert(stateStack.size() >= len);
         auto ite = valueStack.end();
         auto it = ite - static_cast<long>(len);
-        Tolkien anchorToken;
-        std::stringstream ss;
+        vi.token.pos = FilePos();
         for (auto i = it; i < ite; ++i) {
             auto& v = **i;
             if (static_cast<size_t>(i - it) == anchor) {
-                anchorToken = v.token;
+                vi.token.pos = v.token.pos;
             }
-            ss << " " << v.token.str();
             ValueItem* cvi = *i;
             assert(cvi != nullptr);
-            childs.push_back(cvi);
+            vi.childs.push_back(cvi);
         }
         ///PROTOTYPE_ENTER:IF_LOG_PARSER
+        std::stringstream ss;
+        for (auto i = it; i < ite; ++i) {
+            ss << " " << (*i)->token.str();
+        }
         std::print(log(), "pop:{}\n", ss.str());
         ///PROTOTYPE_LEAVE:IF_LOG_PARSER
         for (size_t i = 0; i < len; ++i) {
             stateStack.pop_back();
             valueStack.pop_back();
         }
-        return anchorToken;
     }
 
-    inline void reduce(const size_t& ruleID, const size_t& len, const size_t& anchor, const Tolkien::ID& k, const std::string& text) {
-        std::vector<ValueItem*> childs;
-        auto tok = _reduce(len, anchor, childs);
-        tok.id = k;
-        tok.text = text;
-        auto& vi = shift(tok);
+    inline void reduce(const size_t& ruleID, const size_t& len, const size_t& anchor, const Tolkien::ID& k, const std::string_view& text) {
+#if HAS_PROFILER
+        ++ast.pub.stats.reduces;
+#endif
+        auto& vi = nextValue();
+        _reduce(len, anchor, vi);
+        vi.token.id = k;
+        vi.token.text = text;
         vi.ruleID = ruleID;
-        vi.childs = childs;
+        valueStack.push_back(&vi);
     }
 
     inline bool isClean() const {
@@ -562,9 +1059,113 @@ struct Parser {
     };
     ///PROTOTYPE_LEAVE:SKIP
 
+    ///PROTOTYPE_ENTER:IF_RESULT
+    // set instead of throwing on lexer and parser errors, checked by the lexer after each token
+    bool failed = false;
+    TAG(Q_NSNAME)TAG(CLSNAME)::Failure failure;
+
+    inline void fail(const TAG(Q_NSNAME)TAG(CLSNAME)::Failure::Code& code, const FilePos& p, const Tolkien& k, const std::string_view& expected) {
+        failed = true;
+        failure.code = code;
+        failure.row = p.row;
+        failure.col = p.col;
+        failure.file = p.file;
+        failure.token = static_cast<size_t>(k.id);
+        failure.text = k.text;
+        failure.expected = expected;
+    }
+
+    inline void failSyntax(const Tolkien& k, const std::string_view& expected) {
+        fail(TAG(Q_NSNAME)TAG(CLSNAME)::Failure::Code::Syntax, k.pos, k, expected);
+    }
+
+    inline void failToken(const FilePos& p, const Tolkien& k) {
+        fail(TAG(Q_NSNAME)TAG(CLSNAME)::Failure::Code::Token, p, k, "");
+    }
+    ///PROTOTYPE_LEAVE:IF_RESULT
+
+    ///PROTOTYPE_ENTER:IF_UNITS
+    // the unit passed to parseUnit(), shifted by parse() in place of its first token
+    ValueItem* unit = nullptr;
+    bool spliced = false;
+
+    // the state after the GOTO on the unit ruleset from @arg state, 0 if there is none
+    static inline size_t unitGoto(const size_t& state) {
+        switch(state) {
+        ///PROTOTYPE_SEGMENT:unitGotos
+        default:
+            break;
+        }
+        return 0;
+    }
+
+    inline void spliceUnit() {
+        auto next = unitGoto(stateStack.back());
+        if(next == 0) {
+            return;
+        }
+        valueStack.push_back(unit);
+        stateStack.push_back(next);
+        spliced = true;
+    }
+
+    // shift @arg u, a unit parsed by another parser from the tokens starting with @arg first
+    // the parser first reduces as if it had read @arg first, then moves to the GOTO state of the unit
+    // returns false if the unit cannot follow in this state, the tokens must then be parsed one by one
+    inline bool parseUnit(ValueItem& u, const Tolkien& first) {
+        unit = &u;
+        spliced = false;
+        parse(first);
+        unit = nullptr;
+        return spliced;
+    }
+
+    // start parsing another unit, keeping the values of the earlier units
+    inline void restart() {
+        ///PROTOTYPE_ENTER:IF_RESULT
+        failed = false;
+        ///PROTOTYPE_LEAVE:IF_RESULT
+        valueStack.clear();
+        stateStack.clear();
+        stateStack.push_back(1);
+    }
+    ///PROTOTYPE_LEAVE:IF_UNITS
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    /// @brief the parser stacks after a token
+    /// The parser only adds values after valueCount, so the values on the stacks stay as they are
+    /// until the parser is restored to an earlier snapshot and parses other tokens.
+    struct Snapshot {
+        size_t valueCount = 0;
+        std::vector<ValueItem*> valueStack;
+        std::vector<size_t> stateStack;
+        ///PROTOTYPE_ENTER:IF_RESULT
+        bool failed = false;
+        ///PROTOTYPE_LEAVE:IF_RESULT
+    };
+
+    inline void save(Snapshot& s) const {
+        s.valueCount = valueCount;
+        s.valueStack = valueStack;
+        s.stateStack = stateStack;
+        ///PROTOTYPE_ENTER:IF_RESULT
+        s.failed = failed;
+        ///PROTOTYPE_LEAVE:IF_RESULT
+    }
+
+    inline void restore(const Snapshot& s) {
+        valueCount = s.valueCount;
+        valueStack = s.valueStack;
+        stateStack = s.stateStack;
+        ///PROTOTYPE_ENTER:IF_RESULT
+        failed = s.failed;
+        ///PROTOTYPE_LEAVE:IF_RESULT
+    }
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
     inline void begin();
-    inline bool parse(const Tolkien& k0);
-    inline void leave();
+    TAG(INLINE)bool parse(const Tolkien& k0);
+    TAG(INLINE)void leave();
 }; // Parser
 
 template<>
@@ -583,45 +1184,50 @@ inline TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(START_RULE)& Parser::create<TAG(Q_NS
 
 ///PROTOTYPE_SEGMENT:createASTNodesDecls
 
-///PROTOTYPE_SEGMENT:createASTNodesDefns
-
 inline void Parser::begin() {
-    values.clear();
+    ///PROTOTYPE_ENTER:IF_RESULT
+    failed = false;
+    ///PROTOTYPE_LEAVE:IF_RESULT
+    valueCount = 0;
     valueStack.clear();
     stateStack.clear();
     stateStack.push_back(1);
+    items = 0;
 }
 
-inline bool Parser::parse(const Tolkien& k0) {
-    bool accepted = false;
-    Tolkien k = k0;
-    while (!accepted) {
-        ///PROTOTYPE_ENTER:IF_LOG_PARSER
-        printParserState(k);
-        ///PROTOTYPE_LEAVE:IF_LOG_PARSER
+// lets the lexer read a buffer held in memory in place
+struct ChunkBuffer : public std::streambuf {
+    inline void set(const std::string_view& data) {
+        auto b = const_cast<char*>(data.data());
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+        setg(b, b, b + data.size());
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+    }
 
-        assert(stateStack.size() > 0);
-        switch (stateStack.back()) {
-            ///PROTOTYPE_SEGMENT:parserTransitions
+    ///PROTOTYPE_ENTER:IF_CAPTURE
+    // offset of the first byte of the character last read from the buffer
+    // the UTF-8 reader leaves the buffer at the last byte of a sequence
+    inline size_t lookahead() const {
+        auto p = gptr();
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+        if constexpr (sizeof(char_t) > 1) {
+            for(size_t i = 0; (i < 3) && (p > eback()) && (p < egptr()) && ((static_cast<uint8_t>(*p) & 0xC0) == 0x80); ++i) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+                --p;
+            }
         }
-    } // while(!accepted)
-    return accepted;
-} // parse()
-
-inline void Parser::leave() {
-    ///PROTOTYPE_ENTER:IF_LOG_PARSER
-    std::print(log(), "parse done\n");
-    printParserState();
-    ///PROTOTYPE_LEAVE:IF_LOG_PARSER
-
-    if(valueStack.size() != 1) {
-        // control flow won't usually reach here
-        throw std::runtime_error("parse error");
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+        return static_cast<size_t>(p - eback());
     }
-    auto& vi = *(valueStack.at(0));
-    auto& R_start = create<TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(START_RULE)>(vi);
-    ast.R_start = &R_start;
-}
+    ///PROTOTYPE_LEAVE:IF_CAPTURE
+};
 
 struct Lexer {
     Parser& parser;
@@ -631,10 +1237,60 @@ struct Lexer {
     std::vector<size_t> modes;
 
     bool _eof = false;
+
+    ///PROTOTYPE_ENTER:IF_CAPTURE
+    /// @brief tokens scanned ahead of the parser from some offset of an input held in memory
+    /// used by readParallel(), where each chunk of the input is scanned on its own thread
+    /// assuming that it starts in the initial mode, and the tokens are parsed later in order,
+    /// by readUnits(), where the tokens are split into units that are parsed on several threads,
+    /// and by readDocument(), where the tokens are kept so that updateDocument() can reuse them
+    struct Capture {
+        struct Item {
+            Tolkien token;
+
+            // offset, row and column of the character after the token
+            size_t end = 0;
+            size_t row = 0;
+            size_t col = 0;
+
+            // true if the lexer is in the initial mode after the token
+            bool initMode = true;
+        };
+
+        // the buffer being scanned, and its offset in the input
+        const ChunkBuffer* buffer = nullptr;
+        size_t base = 0;
+
+        // the scan stops after the first token that ends at or after this offset
+        size_t limit = 0;
+
+        std::vector<Item> items;
+
+        // the modes after the last token
+        std::vector<size_t> modes;
+
+        // true if the scan stopped at an error before the limit
+        bool truncated = false;
+
+        inline bool add(const Tolkien& t, const Stream& stream, const std::vector<size_t>& m) {
+            auto end = base + buffer->lookahead();
+            items.push_back(Item{t, end, stream.pos.row, stream.pos.col, (m.size() == 1)});
+            modes = m;
+            return (end < limit);
+        }
+    };
+
+    // set while scanning ahead for readParallel(), readUnits() or readDocument(), the tokens are then added here instead of being parsed
+    Capture* capture = nullptr;
+    ///PROTOTYPE_LEAVE:IF_CAPTURE
     inline Lexer(Parser& p) : parser(p) {
         modes.push_back(1);
     }
 
+    inline std::ostream& log() const {
+        return parser.log();
+    }
+
     inline const size_t& modeRoot() const {
         assert(modes.size() > 0);
         return modes.back();
@@ -647,7 +1303,7 @@ struct Lexer {
 
     inline void begin() {
         state = 1;
-        token = Tolkien();
+        token.reset(FilePos());
         counts.clear();
         modes.clear();
         modes.push_back(1);
@@ -662,36 +1318,124 @@ struct Lexer {
         return token;
     }
 
-    inline void next(Stream& stream) {
-        if (token.id == Tolkien::ID::_tEND) {
-            assert(_eof == false);
-            _eof = true;
-            return;
-        }
-        token = Tolkien(stream.pos);
-        while (!stream.eof()) {
-            auto& ch = stream.peek();
-            ///PROTOTYPE_ENTER:IF_LOG_LEXER
-            std::print(log(), "{}: Lexer:state={}, ch={}/{}, count={}\n", stream.pos.str(), state, (static_cast<int>(ch) == EOF ? "EOF" : std::to_string(ch)), std::isprint(static_cast<int>(ch)) ? static_cast<char>(ch) : ' ', counts.size());
-            ///PROTOTYPE_LEAVE:IF_LOG_LEXER
-            switch (state) {
-                ///PROTOTYPE_SEGMENT:lexerStates
-            } // switch(state)
-        } // while(!eof)
-        // parser.parse(token);
-        // std::print("leave-lex-2\n");
-    } // next()
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    /// @brief the state of the lexer at the end of a chunk, including the part of the token read so far
+    struct Snapshot {
+        size_t state = 1;
+        Tolkien token;
+        std::vector<size_t> counts;
+        std::vector<size_t> modes;
+        bool eof = false;
+    };
+
+    inline void save(Snapshot& s) const {
+        s.state = state;
+        s.token = token;
+        s.counts = counts;
+        s.modes = modes;
+        s.eof = _eof;
+    }
+
+    inline void restore(const Snapshot& s) {
+        state = s.state;
+        token = s.token;
+        counts = s.counts;
+        modes = s.modes;
+        _eof = s.eof;
+    }
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+    TAG(INLINE)void next(Stream& stream);
 }; // Lexer
 } // namespace
 
+///PROTOTYPE_ENTER:IF_UNITS
+// compile with -DUNITS_WINDOW=<n> to change the size of the parts of the input that readUnits() scans at a time
+// the tokens of one part are held in memory at a time
+#if !defined(UNITS_WINDOW)
+#define UNITS_WINDOW (16 << 20)
+#endif
+///PROTOTYPE_LEAVE:IF_UNITS
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+// compile with -DDOCUMENT_CHECKPOINT_LINES=<n> to change the number of lines between the parser checkpoints of readDocument()
+// each checkpoint holds a copy of the parser stacks
+#if !defined(DOCUMENT_CHECKPOINT_LINES)
+#define DOCUMENT_CHECKPOINT_LINES 64
+#endif
+
+// compile with -DDOCUMENT_CHECKPOINT_TOKENS=<n> to change the largest number of tokens between two checkpoints,
+// which bounds the tokens parsed again in documents with few and long lines
+#if !defined(DOCUMENT_CHECKPOINT_TOKENS)
+#define DOCUMENT_CHECKPOINT_TOKENS 4096
+#endif
+
+struct TAG(Q_NSNAME)TAG(CLSNAME)::Snapshot::Data {
+    // the stream and the branch of it that the snapshot was taken in
+    uint64_t stream = 0;
+    size_t branch = 0;
+
+    Lexer::Snapshot lexer;
+    Parser::Snapshot parser;
+
+    // the stream being read by readChunk()
+    bool chunked = false;
+    std::string chunkFile;
+    std::string chunkTail;
+    bool hasStream = false;
+    FilePos pos;
+};
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+///PROTOTYPE_ENTER:IF_PARALLEL
+// compile with -DPARALLEL_CHUNK=<n> to change the size of the chunks that readParallel() scans on each thread
+// the tokens of one chunk per thread are held in memory at a time
+#if !defined(PARALLEL_CHUNK)
+#define PARALLEL_CHUNK (1 << 20)
+#endif
+
+// compile with -DPARALLEL_THREADS=<n> to change the number of threads used when readParallel() is called with 0 threads
+// 0 uses one thread per core
+#if !defined(PARALLEL_THREADS)
+#define PARALLEL_THREADS 0
+#endif
+///PROTOTYPE_LEAVE:IF_PARALLEL
+
 struct TAG(Q_NSNAME)TAG(CLSNAME)::Impl {
     TAG(CLSNAME)& ymodule;
     TAG(AST) ast;
     Parser parser;
     Lexer lexer;
     std::ofstream flog;
+    std::ostream* _log = nullptr;
     bool walking = false;
 
+    // lets the lexer read each chunk passed to readChunk() in place
+    ChunkBuffer chunkBuffer;
+    std::istream chunkIn{&chunkBuffer};
+
+    // the stream being read by readChunk(), until endStream()
+    bool chunked = false;
+    std::string chunkFile;
+    std::optional<Stream> chunkStream;
+
+    // a UTF-8 sequence split at the end of a chunk, completed by the next chunk
+    std::string chunkTail;
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    /// @brief a run of the stream started by restore(), from a snapshot taken in its parent branch
+    /// The branch keeps the first valueCount values of its parent, the later ones are overwritten by it.
+    struct Branch {
+        size_t parent = 0;
+        size_t valueCount = 0;
+    };
+
+    // the stream being read, and its branches, for checking that a snapshot is still valid
+    uint64_t streamSerial = 0;
+    std::vector<Branch> branches{Branch{}};
+    size_t branch = 0;
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
     struct WalkingGuard {
         Impl& impl;
         inline WalkingGuard(Impl& i) : impl(i) {
@@ -709,15 +1453,13 @@ struct TAG(Q_NSNAME)TAG(CLSNAME)::Impl {
         , parser(ast)
         , lexer(parser)
     {
-        if(_log == nullptr) {
-            if(lname == "-") {
-                _log = &std::cout;
-            }else{
-                if(lname.size() > 0) {
-                    flog.open(lname);
-                }
-                _log = &flog;
+        if(lname == "-") {
+            _log = &std::cout;
+        }else{
+            if(lname.size() > 0) {
+                flog.open(lname);
             }
+            _log = &flog;
         }
     }
 
@@ -725,17 +1467,176 @@ struct TAG(Q_NSNAME)TAG(CLSNAME)::Impl {
         if(walking == true) {
             throw std::runtime_error("Cannot read stream while walking");
         }
+        ast.begin();
         lexer.begin();
         parser.begin();
+        chunked = false;
+        chunkStream.reset();
+        chunkTail.clear();
+        ///PROTOTYPE_ENTER:IF_INCREMENTAL
+        documentValid = false;
+        ++streamSerial;
+        branches.assign(1, Branch{});
+        branch = 0;
+        ///PROTOTYPE_LEAVE:IF_INCREMENTAL
     }
 
     inline void readStream(std::istream& is, const std::string_view& filename) {
+        ///PROTOTYPE_ENTER:IF_RESULT
+        if(parser.failed == true) {
+            return;
+        }
+        ///PROTOTYPE_LEAVE:IF_RESULT
+#if HAS_PROFILER
+        Stats::Timer t(ymodule.stats.readNS);
+#endif
         Stream stream(is, filename);
         lexer.next(stream);
     }
 
-    inline void endStream() {
-        parser.leave();
+    // number of bytes in the UTF-8 sequence started by @arg c, 1 for other bytes
+    static inline size_t seqLength(const char& c) {
+        auto b = static_cast<uint8_t>(c);
+        if((b & 0xE0) == 0xC0) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            return 2;
+        }
+        if((b & 0xF0) == 0xE0) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            return 3; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+        if((b & 0xF8) == 0xF0) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            return 4; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+        return 1;
+    }
+
+    // number of bytes at the end of @arg s that start a UTF-8 sequence completed by a later chunk
+    static inline size_t splitLength(const std::string_view& s) {
+        for(size_t i = 1; (i < 4) && (i <= s.size()); ++i) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            auto c = static_cast<uint8_t>(s[s.size() - i]);
+            if((c & 0xC0) != 0x80) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+                return (seqLength(s[s.size() - i]) > i) ? i : 0;
+            }
+        }
+        return 0;
+    }
+
+    inline void lexChunk(const std::string_view& data) {
+        if(data.size() == 0) {
+            return;
+        }
+        ///PROTOTYPE_ENTER:IF_RESULT
+        if(parser.failed == true) {
+            return;
+        }
+        ///PROTOTYPE_LEAVE:IF_RESULT
+        chunkBuffer.set(data);
+        chunkIn.clear();
+        if(chunkStream.has_value() == false) {
+            chunkStream.emplace(chunkIn, chunkFile);
+            chunkStream->setPartial(true);
+        }else{
+            chunkStream->resume();
+        }
+        lexer.next(*chunkStream);
+    }
+
+    inline void readChunk(std::string_view chunk, const std::string_view& filename) {
+        ///PROTOTYPE_ENTER:IF_RESULT
+        if(parser.failed == true) {
+            return;
+        }
+        ///PROTOTYPE_LEAVE:IF_RESULT
+#if HAS_PROFILER
+        Stats::Timer t(ymodule.stats.readNS);
+#endif
+        if(chunked == false) {
+            chunked = true;
+            chunkFile = filename;
+        }
+
+        if(chunkTail.size() > 0) {
+            auto n = std::min(seqLength(chunkTail.at(0)) - chunkTail.size(), chunk.size());
+            chunkTail.append(chunk.substr(0, n));
+            chunk.remove_prefix(n);
+            if(chunkTail.size() < seqLength(chunkTail.at(0))) {
+                return;
+            }
+            lexChunk(chunkTail);
+            chunkTail.clear();
+        }
+
+        auto n = splitLength(chunk);
+        lexChunk(chunk.substr(0, chunk.size() - n));
+        chunkTail.assign(chunk.substr(chunk.size() - n));
+    }
+
+    // ends the stream read by readChunk(), so that the lexer sees the EOF
+    inline void endChunks() {
+        if(chunked == false) {
+            return;
+        }
+        chunked = false;
+        ///PROTOTYPE_ENTER:IF_RESULT
+        if(parser.failed == true) {
+            return;
+        }
+        ///PROTOTYPE_LEAVE:IF_RESULT
+        if(chunkTail.size() > 0) {
+            lexChunk(chunkTail);
+            chunkTail.clear();
+        }
+        if(chunkStream.has_value() == false) {
+            // no data was read, the lexer sees an empty stream
+            chunkBuffer.set({});
+            chunkIn.clear();
+            chunkStream.emplace(chunkIn, chunkFile);
+        }
+        chunkStream->setPartial(false);
+        lexer.next(*chunkStream);
+        chunkStream.reset();
+    }
+
+    inline void endStream() {
+        endChunks();
+        ///PROTOTYPE_ENTER:IF_RESULT
+        if(parser.failed == true) {
+            return;
+        }
+        ///PROTOTYPE_LEAVE:IF_RESULT
+#if HAS_PROFILER
+        auto n0 = ast.astNodeCount;
+        {
+            Stats::Timer t(ymodule.stats.astNS);
+            parser.leave();
+        }
+        ymodule.stats.astNodes += ast.astNodeCount - n0;
+#else
+        parser.leave();
+#endif
+    }
+
+    inline size_t completedItems() {
+        auto n = parser.items;
+        parser.items = 0;
+        return n;
+    }
+
+    inline void reset() {
+        if(walking == true) {
+            throw std::runtime_error("Cannot reset while walking");
+        }
+        ast.reset();
+        lexer.begin();
+        parser.begin();
+        chunked = false;
+        chunkStream.reset();
+        chunkTail.clear();
+        ///PROTOTYPE_ENTER:IF_INCREMENTAL
+        documentValid = false;
+        ++streamSerial;
+        branches.assign(1, Branch{});
+        branch = 0;
+        ///PROTOTYPE_LEAVE:IF_INCREMENTAL
     }
 
     inline void read(std::istream& is, const std::string_view& filename) {
@@ -744,6 +1645,732 @@ struct TAG(Q_NSNAME)TAG(CLSNAME)::Impl {
         endStream();
     }
 
+    ///PROTOTYPE_ENTER:IF_CAPTURE
+    /// @brief where the lexer resumes in readParallel() and readUnits(): the offset and position after the last parsed token
+    struct Resume {
+        size_t offset = 0;
+        FilePos pos;
+        std::vector<size_t> modes;
+    };
+
+    // scan the tokens in @arg input from @arg r up to @arg limit into @arg c
+    // the scan has its own parser, so that it can run on any thread and only records an error
+    inline void scan(const std::string_view& input, const Resume& r, const size_t& limit, Lexer::Capture& c) {
+        c.items.clear();
+        c.modes = r.modes;
+        c.truncated = false;
+        c.base = r.offset;
+        c.limit = limit;
+        try {
+            ChunkBuffer buf;
+            buf.set(input.substr(r.offset));
+            std::istream in(&buf);
+            Stream stream(in, r.pos.file);
+            stream.pos = r.pos;
+            stream.setPartial(true);
+
+            TAG(AST) sast(ymodule);
+            Parser sparser(sast);
+            Lexer slexer(sparser);
+            slexer.modes = r.modes;
+            slexer.state = slexer.modeRoot();
+            slexer.token.reset(r.pos);
+            slexer.capture = &c;
+            c.buffer = &buf;
+            slexer.next(stream);
+            c.buffer = nullptr;
+            ///PROTOTYPE_ENTER:IF_RESULT
+            if(sparser.failed == true) {
+                c.truncated = true;
+            }
+            ///PROTOTYPE_LEAVE:IF_RESULT
+        }catch(const std::exception&) {
+            // the error is reported when the lexer reaches it in order
+            c.buffer = nullptr;
+            c.truncated = true;
+        }
+    }
+
+    // parse the tokens in @arg c from @arg from, and move @arg r past the last of them
+    // the tokens are moved down by @arg rowDelta rows first, for a capture scanned before its row was known
+    inline void replay(Lexer::Capture& c, const size_t& from, Resume& r, const size_t& rowDelta) {
+        if(from >= c.items.size()) {
+            return;
+        }
+        for(size_t i = from; i < c.items.size(); ++i) {
+            auto& item = c.items.at(i);
+            item.token.pos.row += rowDelta;
+            item.row += rowDelta;
+            parser.parse(item.token);
+            ///PROTOTYPE_ENTER:IF_RESULT
+            if(parser.failed == true) {
+                return;
+            }
+            ///PROTOTYPE_LEAVE:IF_RESULT
+        }
+        auto& last = c.items.back();
+        r.offset = last.end;
+        r.pos.row = last.row;
+        r.pos.col = last.col;
+        r.modes = c.modes;
+    }
+
+    // lex the rest of @arg input from @arg r up to the EOF in order
+    inline void lexRest(const std::string_view& input, const std::string_view& filename, const Resume& r) {
+        chunkBuffer.set(input.substr(r.offset));
+        chunkIn.clear();
+        Stream stream(chunkIn, filename);
+        stream.pos = r.pos;
+        lexer.modes = r.modes;
+        lexer.state = lexer.modeRoot();
+        lexer.token.reset(r.pos);
+        lexer.next(stream);
+    }
+    ///PROTOTYPE_LEAVE:IF_CAPTURE
+
+    ///PROTOTYPE_ENTER:IF_PARALLEL
+    /// @brief one chunk of the input of readParallel()
+    /// Each chunk starts just after a newline, and is scanned on its own thread as if
+    /// the lexer was in the initial mode there. The scan continues past the end of the chunk
+    /// until a token ends at or after it, so that the next chunk can pick up its tokens from there.
+    struct Speculation {
+        size_t begin = 0;
+        size_t end = 0;
+        size_t newlines = 0;
+
+        // the chunk is scanned from row 1, its tokens are moved down by this many rows when they are parsed
+        size_t rowDelta = 0;
+        Lexer::Capture capture;
+    };
+
+    inline void readParallel(const std::string_view& input, const std::string_view& filename, size_t threads) {
+        beginStream();
+#if HAS_PROFILER
+        auto t0 = std::chrono::steady_clock::now();
+#endif
+        ///PROTOTYPE_ENTER:IF_LOG_LEXER
+        // the log of the lexers would be interleaved
+        threads = 1;
+        ///PROTOTYPE_LEAVE:IF_LOG_LEXER
+        if(threads == 0) {
+            threads = PARALLEL_THREADS;
+        }
+        if(threads == 0) {
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        Resume r{0, FilePos(), {1}};
+        r.pos.file = filename;
+
+        std::vector<Speculation> specs;
+        Lexer::Capture rescan;
+
+        // the stream moves to the next row when it reads a newline, and counts the newline as column 1
+        // except for a newline at the start of the input
+        size_t row = ((input.size() > 0) && (input.front() == '\n')) ? 0 : 1;
+
+        size_t begin = 0;
+        while((threads > 1) && (begin < input.size())) {
+            // split the next part of the input into one chunk per thread, each starting just after a newline
+            size_t n = 0;
+            while((n < threads) && (begin < input.size())) {
+                auto end = input.size();
+                if(input.size() - begin > PARALLEL_CHUNK + PARALLEL_CHUNK / 2) {
+                    end = input.find('\n', begin + PARALLEL_CHUNK);
+                    end = (end == std::string_view::npos) ? input.size() : end + 1;
+                }
+                if(specs.size() == n) {
+                    specs.emplace_back();
+                }
+                specs.at(n).begin = begin;
+                specs.at(n).end = end;
+                begin = end;
+                ++n;
+            }
+            if(n < 2) {
+                // the lexer below reads the rest of the input
+                break;
+            }
+
+            // each chunk counts its newlines and is scanned on its own thread, from row 1 since the rows before it are not known yet
+            auto scanChunk = [this, &input, &r](Speculation& s) {
+                s.newlines = static_cast<size_t>(std::count(input.begin() + static_cast<ptrdiff_t>(s.begin), input.begin() + static_cast<ptrdiff_t>(s.end), '\n'));
+                auto st = r;
+                st.offset = s.begin;
+                if(s.begin > 0) {
+                    st.pos.row = (input.at(s.begin) == '\n') ? 2 : 1;
+                    st.pos.col = (input.at(s.begin) == '\n') ? 1 : 2;
+                }
+                st.modes.assign(1, 1);
+                scan(input, st, s.end, s.capture);
+            };
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(n - 1);
+                for(size_t i = 1; i < n; ++i) {
+                    workers.emplace_back(scanChunk, std::ref(specs.at(i)));
+                }
+                scanChunk(specs.at(0));
+            }
+
+            // the row of each chunk follows from the newlines before it
+            for(size_t i = 0; i < n; ++i) {
+                auto& s = specs.at(i);
+                s.rowDelta = (s.begin > 0) ? row - 1 : 0;
+                row += s.newlines;
+            }
+
+            // parse the tokens of each chunk from the first one that the lexer would also have reached from the previous chunk
+            // rescanning the chunk here if there is none, as when it starts inside a string or comment
+            for(size_t i = 0; i < n; ++i) {
+                auto& s = specs.at(i);
+                Lexer::Capture* c = &(s.capture);
+                auto rowDelta = s.rowDelta;
+                size_t from = 0;
+                bool synced = false;
+                if(r.modes.size() == 1) {
+                    if(r.offset == s.begin) {
+                        synced = true;
+                    }else{
+                        auto it = std::lower_bound(c->items.begin(), c->items.end(), r.offset, [](const Lexer::Capture::Item& item, const size_t& offset) {
+                            return item.end < offset;
+                        });
+                        if((it != c->items.end()) && (it->end == r.offset) && (it->initMode == true)) {
+                            from = static_cast<size_t>(it - c->items.begin()) + 1;
+                            synced = true;
+                        }
+                    }
+                }
+                if(synced == false) {
+                    scan(input, r, s.end, rescan);
+                    c = &rescan;
+                    rowDelta = 0;
+                    from = 0;
+                }
+                replay(*c, from, r, rowDelta);
+                ///PROTOTYPE_ENTER:IF_RESULT
+                if(parser.failed == true) {
+                    return;
+                }
+                ///PROTOTYPE_LEAVE:IF_RESULT
+                if((c->truncated == true) && (c != &rescan)) {
+                    scan(input, r, s.end, rescan);
+                    c = &rescan;
+                    replay(*c, 0, r, 0);
+                    ///PROTOTYPE_ENTER:IF_RESULT
+                    if(parser.failed == true) {
+                        return;
+                    }
+                    ///PROTOTYPE_LEAVE:IF_RESULT
+                }
+                if(c->truncated == true) {
+                    // the lexer below reaches the error
+                    begin = input.size();
+                    break;
+                }
+            }
+        }
+
+        lexRest(input, filename, r);
+#if HAS_PROFILER
+        ymodule.stats.readNS += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+#endif
+        endStream();
+    }
+    ///PROTOTYPE_LEAVE:IF_PARALLEL
+
+    ///PROTOTYPE_ENTER:IF_UNITS
+    /// @brief a run of tokens that ends with the separator set by `%parallel_units`
+    /// The tokens are parsed on their own into the value of the unit by one of the unit parsers,
+    /// and the main parser then shifts the value in place of the tokens.
+    struct Unit {
+        size_t begin = 0;
+        size_t end = 0;
+        Parser::ValueItem* value = nullptr;
+    };
+
+    // true if the separator is the last token of the unit, false if it separates the units
+    static constexpr bool unitHasSeparator = TAG(UNIT_SEPARATOR_IN_UNIT);
+
+    // the parsers of the units on each thread, they hold the values of the units until endStream()
+    std::vector<std::unique_ptr<Parser>> unitParsers;
+    Lexer::Capture unitTokens;
+    std::vector<Unit> units;
+
+    // number of tokens under @arg vi, not counting the EMPTY tokens of epsilon rules
+    static inline size_t countTokens(Parser::ValueItem& vi, std::vector<Parser::ValueItem*>& stack) {
+        size_t n = 0;
+        stack.clear();
+        stack.push_back(&vi);
+        while(stack.size() > 0) {
+            auto* v = stack.back();
+            stack.pop_back();
+            if(v->childs.size() == 0) {
+                if(v->token.id != Tolkien::ID::_tEMPTY) {
+                    ++n;
+                }
+                continue;
+            }
+            for(auto* c : v->childs) {
+                stack.push_back(c);
+            }
+        }
+        return n;
+    }
+
+    // parse the tokens of @arg u on their own with @arg p, as if they were the whole input
+    // sets the value of the unit if all its tokens reduce to the unit ruleset, leaves it null otherwise
+    inline void parseAlone(Parser& p, Unit& u, std::vector<Parser::ValueItem*>& stack) const {
+        u.value = nullptr;
+        p.restart();
+        const auto& items = unitTokens.items;
+        try {
+            for(size_t i = u.begin; i < u.end; ++i) {
+                p.parse(items.at(i).token);
+                ///PROTOTYPE_ENTER:IF_RESULT
+                if(p.failed == true) {
+                    return;
+                }
+                ///PROTOTYPE_LEAVE:IF_RESULT
+            }
+            Tolkien end(items.at(u.end - 1).token.pos);
+            end.id = Tolkien::ID::_tEND;
+            do {
+                p.parse(end);
+                ///PROTOTYPE_ENTER:IF_RESULT
+                if(p.failed == true) {
+                    return;
+                }
+                ///PROTOTYPE_LEAVE:IF_RESULT
+            } while(p.isClean() == false);
+        }catch(const std::exception&) {
+            // the main parser reports the error when it parses these tokens one by one
+            return;
+        }
+
+        // the first value of the unit ruleset, in the order of the input
+        stack.clear();
+        stack.push_back(p.valueStack.at(0));
+        Parser::ValueItem* v = nullptr;
+        while(stack.size() > 0) {
+            auto* c = stack.back();
+            stack.pop_back();
+            if(c->token.id == Tolkien::ID::TAG(UNIT_RULE)) {
+                v = c;
+                break;
+            }
+            for(auto it = c->childs.rbegin(); it != c->childs.rend(); ++it) {
+                stack.push_back(*it);
+            }
+        }
+        if((v != nullptr) && (countTokens(*v, stack) == (u.end - u.begin))) {
+            u.value = v;
+        }
+    }
+
+    inline void readUnits(const std::string_view& input, const std::string_view& filename, size_t threads) {
+        beginStream();
+#if HAS_PROFILER
+        auto t0 = std::chrono::steady_clock::now();
+        // the counters of the profiler are shared by all parsers
+        threads = 1;
+#endif
+        ///PROTOTYPE_ENTER:IF_LOG_PARSER
+        // the log of the parsers would be interleaved
+        threads = 1;
+        ///PROTOTYPE_LEAVE:IF_LOG_PARSER
+        if(threads == 0) {
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        while(unitParsers.size() < threads) {
+            unitParsers.push_back(std::make_unique<Parser>(ast));
+        }
+        for(auto& p : unitParsers) {
+            p->begin();
+        }
+
+        Resume r{0, FilePos(), {1}};
+        r.pos.file = filename;
+        const auto& items = unitTokens.items;
+
+        while(r.offset < input.size()) {
+            // scan the next part of the input, and parse its tokens up to the last separator
+            // the tokens after it are scanned again with the next part
+            auto limit = r.offset + UNITS_WINDOW;
+            scan(input, r, limit, unitTokens);
+            bool more = (items.size() > 0) && (items.back().end >= limit);
+            size_t cut = items.size();
+            if(more == true) {
+                for(size_t i = items.size(); i > 0; --i) {
+                    auto& item = items.at(i - 1);
+                    if((item.token.id == Tolkien::ID::TAG(UNIT_SEPARATOR)) && (item.initMode == true)) {
+                        cut = i;
+                        break;
+                    }
+                }
+            }
+            if(cut == 0) {
+                break;
+            }
+
+            // split the tokens into units, each ending with a separator
+            units.clear();
+            size_t b = 0;
+            for(size_t i = 0; i < cut; ++i) {
+                if(items.at(i).token.id != Tolkien::ID::TAG(UNIT_SEPARATOR)) {
+                    continue;
+                }
+                auto e = (unitHasSeparator == true) ? (i + 1) : i;
+                if(e > b) {
+                    units.push_back(Unit{b, e, nullptr});
+                }
+                b = i + 1;
+            }
+
+            // parse a contiguous run of units on each thread
+            auto n = std::min(threads, units.size());
+            if(n > 0) {
+                auto run = [this, &n](const size_t& t) {
+                    auto& p = *(unitParsers.at(t));
+                    std::vector<Parser::ValueItem*> stack;
+                    auto from = t * units.size() / n;
+                    auto to = (t + 1) * units.size() / n;
+                    for(size_t i = from; i < to; ++i) {
+                        parseAlone(p, units.at(i), stack);
+                    }
+                };
+                std::vector<std::jthread> workers;
+                workers.reserve(n - 1);
+                for(size_t t = 1; t < n; ++t) {
+                    workers.emplace_back(run, t);
+                }
+                run(0);
+            }
+
+            // shift the units in order, and parse the tokens that are not in a unit one by one
+            size_t i = 0;
+            auto parseTo = [this, &items, &i](const size_t& end) {
+                for(; i < end; ++i) {
+                    parser.parse(items.at(i).token);
+                    ///PROTOTYPE_ENTER:IF_RESULT
+                    if(parser.failed == true) {
+                        return false;
+                    }
+                    ///PROTOTYPE_LEAVE:IF_RESULT
+                }
+                return true;
+            };
+            for(auto& u : units) {
+                if(parseTo(u.begin) == false) {
+                    return;
+                }
+                if((u.value != nullptr) && (parser.parseUnit(*(u.value), items.at(u.begin).token) == true)) {
+                    i = u.end;
+                    continue;
+                }
+                ///PROTOTYPE_ENTER:IF_RESULT
+                if(parser.failed == true) {
+                    return;
+                }
+                ///PROTOTYPE_LEAVE:IF_RESULT
+                if(parseTo(u.end) == false) {
+                    return;
+                }
+            }
+            if(parseTo(cut) == false) {
+                return;
+            }
+
+            auto& last = items.at(cut - 1);
+            r.offset = last.end;
+            r.pos.row = last.row;
+            r.pos.col = last.col;
+            if(cut == items.size()) {
+                r.modes = unitTokens.modes;
+            }else{
+                r.modes.assign(1, 1);
+            }
+            if(more == false) {
+                break;
+            }
+        }
+
+        lexRest(input, filename, r);
+#if HAS_PROFILER
+        ymodule.stats.readNS += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+#endif
+        endStream();
+    }
+    ///PROTOTYPE_LEAVE:IF_UNITS
+
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    /// @brief the parser state after a token of the document read by readDocument()
+    /// The state after shifting a token depends only on the tokens before it, and the parser only
+    /// adds values after valueCount, so updateDocument() can resume from a checkpoint before the
+    /// first edit with the values of the unchanged tokens as they are.
+    struct Checkpoint {
+        // number of tokens of the document parsed before the checkpoint, and where the lexer resumes after them
+        size_t token = 0;
+        Resume resume;
+        Parser::Snapshot parser;
+    };
+
+    // the document read by readDocument(), and its tokens up to the last one before the EOF
+    std::string document;
+    std::string documentFile;
+    Lexer::Capture documentTokens;
+    std::vector<Checkpoint> checkpoints;
+
+    // false after another stream is read into the module, the parser values are then no longer those of the document
+    bool documentValid = false;
+
+    // the tokens lexed again by updateDocument()
+    Lexer::Capture relex;
+    std::vector<Lexer::Capture::Item> relexed;
+
+    static inline Resume resumeAfter(const Lexer::Capture::Item& item, const std::vector<size_t>& modes) {
+        Resume r{item.end, item.token.pos, modes};
+        r.pos.row = item.row;
+        r.pos.col = item.col;
+        return r;
+    }
+
+    inline void addCheckpoint(const size_t& token, const Resume& r) {
+        auto& c = checkpoints.emplace_back();
+        c.token = token;
+        c.resume = r;
+        parser.save(c.parser);
+    }
+
+    // parse the tokens of the document from @arg from, which the lexer reaches at @arg r, then lex the last token and the EOF
+    // a checkpoint is added every DOCUMENT_CHECKPOINT_LINES lines or DOCUMENT_CHECKPOINT_TOKENS tokens, whichever comes first,
+    // after a token that leaves the lexer in the initial mode
+    inline void parseDocument(const size_t& from, const Resume& r) {
+        const auto& items = documentTokens.items;
+        for(size_t i = from; i < items.size(); ++i) {
+            auto& item = items.at(i);
+            parser.parse(item.token);
+            ///PROTOTYPE_ENTER:IF_RESULT
+            if(parser.failed == true) {
+                return;
+            }
+            ///PROTOTYPE_LEAVE:IF_RESULT
+            if((item.initMode == true) && ((item.row >= checkpoints.back().resume.pos.row + DOCUMENT_CHECKPOINT_LINES) || (i + 1 >= checkpoints.back().token + DOCUMENT_CHECKPOINT_TOKENS))) {
+                addCheckpoint(i + 1, resumeAfter(item, {1}));
+            }
+        }
+        if(items.size() > from) {
+            lexRest(document, documentFile, resumeAfter(items.back(), documentTokens.modes));
+        }else{
+            lexRest(document, documentFile, r);
+        }
+    }
+
+    inline void readDocument() {
+        beginStream();
+        checkpoints.clear();
+        {
+#if HAS_PROFILER
+            Stats::Timer t(ymodule.stats.readNS);
+#endif
+            Resume r{0, FilePos(), {1}};
+            r.pos.file = documentFile;
+            scan(document, r, document.size(), documentTokens);
+            addCheckpoint(0, r);
+            documentValid = true;
+            parseDocument(0, r);
+        }
+        endStream();
+    }
+
+    inline void readDocument(const std::string_view& text, const std::string_view& filename) {
+        if(walking == true) {
+            throw std::runtime_error("Cannot read stream while walking");
+        }
+        document = text;
+        documentFile = filename;
+        readDocument();
+    }
+
+    inline void updateDocument(const std::vector<TAG(CLSNAME)::Edit>& edits) {
+        if(walking == true) {
+            throw std::runtime_error("Cannot read stream while walking");
+        }
+
+        // the document is unchanged before lo, and in its last tail bytes
+        auto n0 = document.size();
+        size_t lo = n0;
+        size_t tail = n0;
+        for(auto& e : edits) {
+            if(e.offset > document.size()) {
+                // the edits before it are applied, but not lexed
+                documentValid = false;
+                throw std::runtime_error(std::format("Edit outside the document:{}", e.offset));
+            }
+            auto len = std::min(e.length, document.size() - e.offset);
+            document.replace(e.offset, len, e.text);
+            lo = std::min(lo, e.offset);
+            tail = std::min(tail, document.size() - (e.offset + e.text.size()));
+        }
+        tail = std::min({tail, n0 - lo, document.size() - lo});
+
+        if(documentValid == false) {
+            // another stream was read since, the whole document is read again
+            readDocument();
+            return;
+        }
+
+        beginStream();
+        documentValid = true;
+        {
+#if HAS_PROFILER
+            Stats::Timer t(ymodule.stats.readNS);
+#endif
+            // resume from the last checkpoint before the first edit
+            // the lexer looks at the character after each token, so the token before the checkpoint must end before lo
+            auto& items = documentTokens.items;
+            while((checkpoints.size() > 1) && (items.at(checkpoints.back().token - 1).end >= lo)) {
+                checkpoints.pop_back();
+            }
+            auto& cp = checkpoints.back();
+            auto from = cp.token;
+            auto r0 = cp.resume;
+            parser.restore(cp.parser);
+
+            // lex from the checkpoint until a token ends in the unchanged tail where an old token also ended,
+            // with the lexer in the initial mode after both, the old tokens after it are then the same
+            auto ne = document.size() - tail;
+            size_t reuse = 0;
+            size_t window = 4096; // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+            auto r = r0;
+            relexed.clear();
+            while(true) {
+                auto limit = std::max(ne, r.offset) + window;
+                scan(document, r, limit, relex);
+                for(auto& item : relex.items) {
+                    relexed.push_back(item);
+                    if((item.end < ne) || (item.initMode == false)) {
+                        continue;
+                    }
+                    auto oend = item.end + n0 - document.size();
+                    auto it = std::lower_bound(items.begin() + static_cast<ptrdiff_t>(from), items.end(), oend, [](const Lexer::Capture::Item& i, const size_t& offset) {
+                        return i.end < offset;
+                    });
+                    if((it != items.end()) && (it->end == oend) && (it->initMode == true)) {
+                        reuse = static_cast<size_t>(it - items.begin()) + 1;
+                        break;
+                    }
+                }
+                if((reuse > 0) || (relex.truncated == true) || (relex.items.size() == 0) || (relex.items.back().end < limit)) {
+                    // synced, or the scan stopped at an error or the EOF
+                    break;
+                }
+                r = resumeAfter(relex.items.back(), relex.modes);
+                window *= 2;
+            }
+
+            // the old tokens after the edits move with the text before them
+            // the column changes only for the tokens on the row where the edits end
+            auto keep = items.size();
+            if(reuse > 0) {
+                auto& os = items.at(reuse - 1);
+                auto& ns = relexed.back();
+                auto row0 = os.row;
+                auto col0 = os.col;
+                for(size_t i = reuse; i < items.size(); ++i) {
+                    auto& item = items.at(i);
+                    if(item.token.pos.row == row0) {
+                        item.token.pos.col = item.token.pos.col + ns.col - col0;
+                    }
+                    item.token.pos.row = item.token.pos.row + ns.row - row0;
+                    if(item.row == row0) {
+                        item.col = item.col + ns.col - col0;
+                    }
+                    item.row = item.row + ns.row - row0;
+                    item.end = item.end + document.size() - n0;
+                }
+                keep = reuse;
+            }else{
+                documentTokens.modes = relex.modes;
+            }
+            items.erase(items.begin() + static_cast<ptrdiff_t>(from), items.begin() + static_cast<ptrdiff_t>(keep));
+            items.insert(items.begin() + static_cast<ptrdiff_t>(from), relexed.begin(), relexed.end());
+
+            parseDocument(from, r0);
+        }
+        endStream();
+    }
+
+    inline std::shared_ptr<const TAG(CLSNAME)::Snapshot::Data> snapshot() const {
+        auto d = std::make_shared<TAG(CLSNAME)::Snapshot::Data>();
+        d->stream = streamSerial;
+        d->branch = branch;
+        lexer.save(d->lexer);
+        parser.save(d->parser);
+        d->chunked = chunked;
+        d->chunkFile = chunkFile;
+        d->chunkTail = chunkTail;
+        if(chunkStream.has_value() == true) {
+            d->hasStream = true;
+            d->pos = chunkStream->pos;
+        }
+        return d;
+    }
+
+    // true if the values of the parser in @arg d are still those of the snapshot
+    // a branch keeps the values of its parent up to the point where it was restored
+    inline bool kept(const TAG(CLSNAME)::Snapshot::Data& d) const {
+        if(d.stream != streamSerial) {
+            return false;
+        }
+        auto b = branch;
+        while(b != d.branch) {
+            if((b == 0) || (branches.at(b).valueCount < d.parser.valueCount)) {
+                return false;
+            }
+            b = branches.at(b).parent;
+        }
+        return true;
+    }
+
+    inline void restore(const TAG(CLSNAME)::Snapshot::Data& d) {
+        if(walking == true) {
+            throw std::runtime_error("Cannot read stream while walking");
+        }
+        if(kept(d) == false) {
+            throw std::runtime_error("Snapshot is no longer valid");
+        }
+        branches.push_back(Branch{d.branch, d.parser.valueCount});
+        branch = branches.size() - 1;
+        documentValid = false;
+
+        ast.begin();
+        lexer.restore(d.lexer);
+        parser.restore(d.parser);
+        chunked = d.chunked;
+        chunkFile = d.chunkFile;
+        chunkTail = d.chunkTail;
+        chunkStream.reset();
+        if(d.hasStream == true) {
+            // the stream is at the end of the chunk that it was taken after, the next chunk resumes it
+            chunkBuffer.set({});
+            chunkIn.clear();
+            chunkStream.emplace(chunkIn, chunkFile);
+            chunkStream->pos = d.pos;
+            chunkStream->setPartial(true);
+        }
+    }
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+    ///PROTOTYPE_ENTER:IF_RESULT
+    inline TAG(CLSNAME)::Result result() const {
+        if(parser.failed == true) {
+            return TAG(CLSNAME)::Result(parser.failure);
+        }
+        return TAG(CLSNAME)::Result();
+    }
+    ///PROTOTYPE_LEAVE:IF_RESULT
+
     ///PROTOTYPE_SEGMENT:walkerCallImpls
 
     inline void printAST(std::ostream& ss, const size_t& lvl, const std::string& indent) const {
@@ -752,6 +2379,87 @@ struct TAG(Q_NSNAME)TAG(CLSNAME)::Impl {
     }
 };
 
+///PROTOTYPE_TARGET:AST
+
+namespace TAG(IMPLNS){
+///PROTOTYPE_SEGMENT:createASTNodesDefns
+
+TAG(INLINE)void Parser::leave() {
+    ///PROTOTYPE_ENTER:IF_LOG_PARSER
+    std::print(log(), "parse done\n");
+    printParserState();
+    ///PROTOTYPE_LEAVE:IF_LOG_PARSER
+
+    if(valueStack.size() != 1) {
+        // control flow won't usually reach here
+        throw std::runtime_error("parse error");
+    }
+    auto& vi = *(valueStack.at(0));
+    auto& R_start = create<TAG(Q_NSNAME)TAG2(CLSNAME,_AST)::TAG(START_RULE)>(vi);
+    ast.R_start = &R_start;
+}
+} // namespace
+
+///PROTOTYPE_TARGET:PARSER
+
+namespace TAG(IMPLNS){
+TAG(INLINE)bool Parser::parse(const Tolkien& k0) {
+#if HAS_PROFILER
+    ++ast.pub.stats.tokens;
+    TAG(Q_NSNAME)TAG(CLSNAME)::Stats::Timer t(ast.pub.stats.parseNS);
+#endif
+    ///PROTOTYPE_ENTER:IF_HOTSPOTS
+    hotspots.addToken(k0);
+    ///PROTOTYPE_LEAVE:IF_HOTSPOTS
+    ///PROTOTYPE_ENTER:IF_TRACE
+    trace.add(Trace::Kind::Token, stateStack.back(), static_cast<uint32_t>(k0.id), k0.pos);
+    ///PROTOTYPE_LEAVE:IF_TRACE
+    bool accepted = false;
+    Tolkien& k = lookahead;
+    k = k0;
+    while (!accepted) {
+        ///PROTOTYPE_ENTER:IF_LOG_PARSER
+        printParserState(k);
+        ///PROTOTYPE_LEAVE:IF_LOG_PARSER
+
+        assert(stateStack.size() > 0);
+        switch (stateStack.back()) {
+            ///PROTOTYPE_SEGMENT:parserTransitions
+        }
+    } // while(!accepted)
+    return accepted;
+} // parse()
+} // namespace
+
+///PROTOTYPE_TARGET:LEXER
+
+namespace TAG(IMPLNS){
+TAG(INLINE)void Lexer::next(Stream& stream) {
+    if (token.id == Tolkien::ID::_tEND) {
+        assert(_eof == false);
+        _eof = true;
+        return;
+    }
+    // the root states start each token, so a token scanned up to the end of a chunk continues with the next chunk
+    while (!stream.eof()) {
+        auto& ch = stream.peek();
+        ///PROTOTYPE_ENTER:IF_LOG_LEXER
+        std::print(log(), "{}: Lexer:state={}, ch={}/{}, count={}\n", stream.pos.str(), state, (static_cast<int>(ch) == EOF ? "EOF" : std::to_string(ch)), std::isprint(static_cast<int>(ch)) ? static_cast<char>(ch) : ' ', counts.size());
+        ///PROTOTYPE_LEAVE:IF_LOG_LEXER
+        ///PROTOTYPE_ENTER:IF_TRACE
+        parser.trace.add(Trace::Kind::Lexer, state, static_cast<uint32_t>(ch), stream.pos);
+        ///PROTOTYPE_LEAVE:IF_TRACE
+        switch (state) {
+            ///PROTOTYPE_SEGMENT:lexerStates
+        } // switch(state)
+    } // while(!eof)
+    // parser.parse(token);
+    // std::print("leave-lex-2\n");
+} // next()
+} // namespace
+
+///PROTOTYPE_TARGET:MODULE
+
 TAG(Q_NSNAME)TAG(CLSNAME)::TAG(CLSNAME)(const std::string& n, const std::string& lname) : name(n) {
     _impl = std::make_unique<Impl>(*this, lname);
 }
@@ -763,16 +2471,27 @@ void TAG(Q_NSNAME)TAG(CLSNAME)::beginStream() {
     return _impl->beginStream();
 }
 
+size_t TAG(Q_NSNAME)TAG(CLSNAME)::completedItems() {
+    return _impl->completedItems();
+}
+
+///PROTOTYPE_ENTER:IF_THROW
 void TAG(Q_NSNAME)TAG(CLSNAME)::readStream(std::istream& is, const std::string_view& filename) {
     return _impl->readStream(is, filename);
 }
 
+void TAG(Q_NSNAME)TAG(CLSNAME)::readChunk(const std::string_view& chunk, const std::string_view& filename) {
+    return _impl->readChunk(chunk, filename);
+}
+
 void TAG(Q_NSNAME)TAG(CLSNAME)::endStream() {
     return _impl->endStream();
 }
+///PROTOTYPE_LEAVE:IF_THROW
 
 ///PROTOTYPE_SEGMENT:walkerCallDefns
 
+///PROTOTYPE_ENTER:IF_THROW
 void TAG(Q_NSNAME)TAG(CLSNAME)::readFile(const std::string& filename) {
     std::ifstream is(filename);
     if(!is) {
@@ -786,22 +2505,375 @@ void TAG(Q_NSNAME)TAG(CLSNAME)::readString(const std::string& s, const std::stri
     _impl->read(is, filename);
 }
 
+///PROTOTYPE_ENTER:IF_PARALLEL
+void TAG(Q_NSNAME)TAG(CLSNAME)::readParallel(const std::string_view& input, const std::string_view& filename, const size_t& threads) {
+    _impl->readParallel(input, filename, threads);
+}
+///PROTOTYPE_LEAVE:IF_PARALLEL
+
+///PROTOTYPE_ENTER:IF_UNITS
+void TAG(Q_NSNAME)TAG(CLSNAME)::readUnits(const std::string_view& input, const std::string_view& filename, const size_t& threads) {
+    _impl->readUnits(input, filename, threads);
+}
+///PROTOTYPE_LEAVE:IF_UNITS
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+void TAG(Q_NSNAME)TAG(CLSNAME)::readDocument(const std::string_view& text, const std::string_view& filename) {
+    _impl->readDocument(text, filename);
+}
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::updateDocument(const std::vector<Edit>& edits) {
+    _impl->updateDocument(edits);
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+///PROTOTYPE_LEAVE:IF_THROW
+
+///PROTOTYPE_ENTER:IF_RESULT
+std::string TAG(Q_NSNAME)TAG(CLSNAME)::Failure::msg() const {
+    switch(code) {
+    case Code::File:
+        return "Cannot open file:" + text;
+    case Code::Token:
+        return Error::fmt(row, col, file, std::format("TOKEN_ERROR:{}", text));
+    case Code::Syntax:
+        break;
+    }
+    auto received = std::format("{}({})", Tolkien::str(static_cast<Tolkien::ID>(token)), text);
+    return Error::fmt(row, col, file, std::format("SYNTAX_ERROR:received:{}, expected:{}", received, expected));
+}
+
+///PROTOTYPE_ENTER:SKIP
+// the prototype itself is compiled with the IF_THROW variant
+#if 0
+///PROTOTYPE_LEAVE:SKIP
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readStream(std::istream& is, const std::string_view& filename) {
+    _impl->readStream(is, filename);
+    return _impl->result();
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readChunk(const std::string_view& chunk, const std::string_view& filename) {
+    _impl->readChunk(chunk, filename);
+    return _impl->result();
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::endStream() {
+    _impl->endStream();
+    return _impl->result();
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readFile(const std::string& filename) {
+    std::ifstream is(filename);
+    if(!is) {
+        _impl->beginStream();
+        Tolkien k;
+        k.text = filename;
+        _impl->parser.fail(Failure::Code::File, FilePos(), k, "");
+        return _impl->result();
+    }
+    _impl->read(is, filename);
+    return _impl->result();
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readString(const std::string& s, const std::string_view& filename) {
+    std::istringstream is(s);
+    _impl->read(is, filename);
+    return _impl->result();
+}
+
+///PROTOTYPE_ENTER:IF_PARALLEL
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readParallel(const std::string_view& input, const std::string_view& filename, const size_t& threads) {
+    _impl->readParallel(input, filename, threads);
+    return _impl->result();
+}
+///PROTOTYPE_LEAVE:IF_PARALLEL
+
+///PROTOTYPE_ENTER:IF_UNITS
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readUnits(const std::string_view& input, const std::string_view& filename, const size_t& threads) {
+    _impl->readUnits(input, filename, threads);
+    return _impl->result();
+}
+///PROTOTYPE_LEAVE:IF_UNITS
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::readDocument(const std::string_view& text, const std::string_view& filename) {
+    _impl->readDocument(text, filename);
+    return _impl->result();
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Result TAG(Q_NSNAME)TAG(CLSNAME)::updateDocument(const std::vector<Edit>& edits) {
+    _impl->updateDocument(edits);
+    return _impl->result();
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+///PROTOTYPE_ENTER:SKIP
+#endif
+///PROTOTYPE_LEAVE:SKIP
+///PROTOTYPE_LEAVE:IF_RESULT
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::reset() {
+    _impl->reset();
+}
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+const std::string& TAG(Q_NSNAME)TAG(CLSNAME)::document() const {
+    return _impl->document;
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Snapshot TAG(Q_NSNAME)TAG(CLSNAME)::snapshot() const {
+    Snapshot s;
+    s._d = _impl->snapshot();
+    return s;
+}
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::restore(const Snapshot& s) {
+    if(s._d == nullptr) {
+        throw std::runtime_error("Empty snapshot");
+    }
+    _impl->restore(*(s._d));
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::reuseAst(const bool& on) {
+    _impl->ast.recycle = on;
+}
+
+TAG(Q_NSNAME)TAG(CLSNAME)::Hold TAG(Q_NSNAME)TAG(CLSNAME)::hold() {
+    _impl->ast.hold();
+    return Hold(*this, _impl->ast.generation);
+}
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::release(const uint64_t& gen) {
+    _impl->ast.release(gen);
+}
+
 void TAG(Q_NSNAME)TAG(CLSNAME)::printAST(std::ostream& ss, const size_t& lvl, const std::string& indent) const {
     _impl->printAST(ss, lvl, indent);
 }
 
+std::ostream& TAG(Q_NSNAME)TAG(CLSNAME)::log() const {
+    return *(_impl->_log);
+}
+
+///PROTOTYPE_ENTER:IF_HOTSPOTS
+namespace TAG(IMPLNS){
+TAG(INLINE)void Hotspots::dump(std::ostream& os) const {
+    ///PROTOTYPE_ENTER:SKIP
+    static const std::vector<std::string_view> lexerStateNames;
+    static const std::vector<std::string_view> parserStateNames;
+    static const std::vector<std::string_view> ruleNames;
+    ///PROTOTYPE_LEAVE:SKIP
+    ///PROTOTYPE_SEGMENT:hotspotNames
+
+    // hottest first
+    auto dumpCounts = [&os](const std::string_view& kind, const std::vector<uint64_t>& counts, const std::vector<std::string_view>& names) {
+        std::vector<size_t> ids;
+        for(size_t i = 0; i < counts.size(); ++i) {
+            if(counts.at(i) > 0) {
+                ids.push_back(i);
+            }
+        }
+        std::ranges::stable_sort(ids, [&counts](const size_t& lhs, const size_t& rhs) {
+            return counts.at(lhs) > counts.at(rhs);
+        });
+        for(const auto& i : ids) {
+            std::string_view name = (i < names.size()) ? names.at(i) : "";
+            os << std::format("{} {} {} {}\n", kind, i, counts.at(i), name);
+        }
+    };
+
+    os << "# <kind> <id> <count> <description>\n";
+    dumpCounts("lexer_state", lexerStates, lexerStateNames);
+    dumpCounts("parser_state", parserStates, parserStateNames);
+    dumpCounts("rule", rules, ruleNames);
+
+    os << "# token <name> <count> <bytes> <max-length>\n";
+    std::vector<size_t> ids;
+    for(size_t i = 0; i < tokens.size(); ++i) {
+        if(tokens.at(i).count > 0) {
+            ids.push_back(i);
+        }
+    }
+    std::ranges::stable_sort(ids, [this](const size_t& lhs, const size_t& rhs) {
+        return tokens.at(lhs).count > tokens.at(rhs).count;
+    });
+    for(const auto& i : ids) {
+        const auto& ts = tokens.at(i);
+        os << std::format("token {} {} {} {}\n", Tolkien::str(static_cast<Tolkien::ID>(i)), ts.count, ts.bytes, ts.maxLen);
+    }
+    os << std::format("epsilon_shifts {}\n", epsilonShifts);
+}
+} // namespace
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::dumpHotspots(std::ostream& os) const {
+    _impl->parser.hotspots.dump(os);
+}
+///PROTOTYPE_LEAVE:IF_HOTSPOTS
+
+///PROTOTYPE_ENTER:IF_TRACE
+namespace TAG(IMPLNS){
+/// The trace is written in native byte order as:
+/// - header: "YTRC", version, record size, lexer state, parser state, rule and token counts,
+///   number of records added, and number of records that follow
+/// - the name of each token id, as a 16-bit length followed by the name
+/// - the records still in the ring buffer, oldest first
+TAG(INLINE)void Trace::dump(std::ostream& os) const {
+    auto put = [&os](const auto& v) {
+        os.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    };
+
+    static constexpr uint32_t version = 1;
+    auto n = std::min<uint64_t>(next, records.size());
+    os.write("YTRC", 4);
+    put(version);
+    put(static_cast<uint32_t>(sizeof(Record)));
+    put(static_cast<uint32_t>(TAG(LEXER_STATE_COUNT)));
+    put(static_cast<uint32_t>(TAG(PARSER_STATE_COUNT)));
+    put(static_cast<uint32_t>(TAG(RULE_COUNT)));
+    put(static_cast<uint32_t>(TAG(TOKEN_COUNT)));
+    put(next);
+    put(n);
+
+    for(size_t i = 0; i < TAG(TOKEN_COUNT); ++i) {
+        auto name = Tolkien::str(static_cast<Tolkien::ID>(i));
+        put(static_cast<uint16_t>(name.size()));
+        os.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    for(uint64_t i = next - n; i < next; ++i) {
+        put(records[i & (records.size() - 1)]);
+    }
+}
+} // namespace
+
+void TAG(Q_NSNAME)TAG(CLSNAME)::dumpTrace(std::ostream& os) const {
+    _impl->parser.trace.dump(os);
+}
+///PROTOTYPE_LEAVE:IF_TRACE
+
 ///PROTOTYPE_ENTER:SKIP
 #define HAS_REPL 1
 ///PROTOTYPE_LEAVE:SKIP
 
 ///PROTOTYPE_ENTER:repl
+///PROTOTYPE_ENTER:IF_CAPTURE
+// the whole file is read into memory, and read by readUnits() or readParallel()
+inline std::string loadFile(const std::string& filename) {
+    std::ifstream is(filename, std::ios::binary);
+    if(!is) {
+        throw std::runtime_error("Cannot open file:" + filename);
+    }
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+///PROTOTYPE_LEAVE:IF_CAPTURE
+
+///PROTOTYPE_ENTER:IF_THROW
+inline void readFile(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& filename) {
+    ///PROTOTYPE_ENTER:IF_UNITS
+    ymodule.readUnits(loadFile(filename), filename);
+    ///PROTOTYPE_LEAVE:IF_UNITS
+    ///PROTOTYPE_ENTER:IF_NO_UNITS
+    ///PROTOTYPE_ENTER:IF_PARALLEL
+    ymodule.readParallel(loadFile(filename), filename);
+    ///PROTOTYPE_LEAVE:IF_PARALLEL
+    ///PROTOTYPE_ENTER:IF_NO_PARALLEL
+    ymodule.readFile(filename);
+    ///PROTOTYPE_LEAVE:IF_NO_PARALLEL
+    ///PROTOTYPE_LEAVE:IF_NO_UNITS
+}
+
+inline void readString(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& s, const std::string_view& filename) {
+    ///PROTOTYPE_ENTER:IF_UNITS
+    ymodule.readUnits(s, filename);
+    ///PROTOTYPE_LEAVE:IF_UNITS
+    ///PROTOTYPE_ENTER:IF_NO_UNITS
+    ymodule.readString(s, filename);
+    ///PROTOTYPE_LEAVE:IF_NO_UNITS
+}
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+// read the input with readDocument(), then apply each of @arg updates to it with updateDocument()
+// only the errors of the last update are reported, as in an editor where the document is read again after each change
+inline void readDocument(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& s, const std::string_view& filename, const std::vector<std::vector<TAG(Q_NSNAME)TAG(CLSNAME)::Edit>>& updates) {
+    try {
+        ymodule.readDocument(s, filename);
+    }catch(const std::exception&) {
+    }
+    for(size_t i = 0; i + 1 < updates.size(); ++i) {
+        try {
+            ymodule.updateDocument(updates.at(i));
+        }catch(const std::exception&) {
+        }
+    }
+    ymodule.updateDocument(updates.back());
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+///PROTOTYPE_LEAVE:IF_THROW
+
+///PROTOTYPE_ENTER:IF_RESULT
+///PROTOTYPE_ENTER:SKIP
+// the prototype itself is compiled with the IF_THROW variant
+#if 0
+///PROTOTYPE_LEAVE:SKIP
+// the module returns its errors, throw them here so that main() reports them like any other error
+inline void readFile(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& filename) {
+    ///PROTOTYPE_ENTER:IF_UNITS
+    if(auto r = ymodule.readUnits(loadFile(filename), filename); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+    ///PROTOTYPE_LEAVE:IF_UNITS
+    ///PROTOTYPE_ENTER:IF_NO_UNITS
+    ///PROTOTYPE_ENTER:IF_PARALLEL
+    if(auto r = ymodule.readParallel(loadFile(filename), filename); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+    ///PROTOTYPE_LEAVE:IF_PARALLEL
+    ///PROTOTYPE_ENTER:IF_NO_PARALLEL
+    if(auto r = ymodule.readFile(filename); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+    ///PROTOTYPE_LEAVE:IF_NO_PARALLEL
+    ///PROTOTYPE_LEAVE:IF_NO_UNITS
+}
+
+inline void readString(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& s, const std::string_view& filename) {
+    ///PROTOTYPE_ENTER:IF_UNITS
+    if(auto r = ymodule.readUnits(s, filename); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+    ///PROTOTYPE_LEAVE:IF_UNITS
+    ///PROTOTYPE_ENTER:IF_NO_UNITS
+    if(auto r = ymodule.readString(s, filename); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+    ///PROTOTYPE_LEAVE:IF_NO_UNITS
+}
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+// read the input with readDocument(), then apply each of @arg updates to it with updateDocument()
+// only the errors of the last update are reported, as in an editor where the document is read again after each change
+inline void readDocument(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& s, const std::string_view& filename, const std::vector<std::vector<TAG(Q_NSNAME)TAG(CLSNAME)::Edit>>& updates) {
+    static_cast<void>(ymodule.readDocument(s, filename));
+    for(size_t i = 0; i + 1 < updates.size(); ++i) {
+        static_cast<void>(ymodule.updateDocument(updates.at(i)));
+    }
+    if(auto r = ymodule.updateDocument(updates.back()); !r) {
+        throw std::runtime_error(r.error().msg());
+    }
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+///PROTOTYPE_ENTER:SKIP
+#endif
+///PROTOTYPE_LEAVE:SKIP
+///PROTOTYPE_LEAVE:IF_RESULT
+
 #if HAS_REPL
 inline bool doREPL(TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, const std::string& input) {
     if(input == "\\q") {
         return false;
     }
 
-    ymodule.readString(input, "<cmd>");
+    ymodule.reset();
+    readString(ymodule, input, "<cmd>");
     return true;
 }
 #endif
@@ -826,10 +2898,87 @@ inline int help(const std::string& xname, const std::string& msg) {
     std::print("    -v              : print verbose messages to console\n");
     std::print("    -w <walker>     : use walker\n");
     std::print("    -o <filename>   : write output to file <filename>\n");
+#if HAS_PROFILER
+    std::print("    -p              : print time and counts for each phase\n");
+#endif
+    ///PROTOTYPE_ENTER:IF_HOTSPOTS
+    std::print("    -d <filename>   : write the lexer state, parser state and rule counters to file <filename>\n");
+    ///PROTOTYPE_LEAVE:IF_HOTSPOTS
+    ///PROTOTYPE_ENTER:IF_TRACE
+    std::print("    -b <filename>   : write the binary trace of the last lexer and parser steps to file <filename>\n");
+    ///PROTOTYPE_LEAVE:IF_TRACE
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    std::print("    -e <o>,<n>,<s>  : read the input with readDocument(), then replace <n> bytes at offset <o> with <s> with updateDocument()\n");
+    std::print("                      an edit given as +<o>,<n>,<s> is applied in the same updateDocument() call as the one before it\n");
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
     return 1;
 }
 
-inline void doWalk(const size_t& printAstLevel, TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, std::vector<std::string> walkers, const std::filesystem::path& odir, const std::string_view& filename) {
+///PROTOTYPE_ENTER:IF_TRACE
+/// @brief writes the module's trace to @arg file when it goes out of scope
+/// This keeps the trace of the steps leading up to a parse error
+struct TraceWriter {
+    const std::string& file;
+    const TAG(Q_NSNAME)TAG(CLSNAME)& ymodule;
+
+    inline TraceWriter(const std::string& f, const TAG(Q_NSNAME)TAG(CLSNAME)& m) : file(f), ymodule(m) {}
+    inline TraceWriter(const TraceWriter&) = delete;
+    inline TraceWriter(TraceWriter&&) = delete;
+    inline TraceWriter& operator=(const TraceWriter&) = delete;
+    inline TraceWriter& operator=(TraceWriter&&) = delete;
+
+    inline ~TraceWriter() {
+        if(file.size() == 0) {
+            return;
+        }
+        std::ofstream os(file, std::ios::binary);
+        if(!os) {
+            std::print("err:Cannot open file:{}\n", file);
+            return;
+        }
+        ymodule.dumpTrace(os);
+    }
+};
+///PROTOTYPE_LEAVE:IF_TRACE
+
+///PROTOTYPE_ENTER:IF_HOTSPOTS
+/// @brief writes the counters of all inputs read by the module to @arg file
+/// Called once after the last input, since the counters add up across inputs
+inline void writeHotspots(const std::string& file, const TAG(Q_NSNAME)TAG(CLSNAME)& ymodule) {
+    if(file.size() == 0) {
+        return;
+    }
+    std::ofstream os(file);
+    if(!os) {
+        throw std::runtime_error("Cannot open file:" + file);
+    }
+    ymodule.dumpHotspots(os);
+}
+///PROTOTYPE_LEAVE:IF_HOTSPOTS
+
+///PROTOTYPE_ENTER:IF_INCREMENTAL
+// parse an edit passed with -e as <offset>,<length>,<text>, the text may contain commas
+inline bool parseEdit(const std::string& v, TAG(Q_NSNAME)TAG(CLSNAME)::Edit& e) {
+    auto p1 = v.find(',');
+    if(p1 == std::string::npos) {
+        return false;
+    }
+    auto p2 = v.find(',', p1 + 1);
+    if(p2 == std::string::npos) {
+        return false;
+    }
+    try {
+        e.offset = std::stoul(v.substr(0, p1));
+        e.length = std::stoul(v.substr(p1 + 1, p2 - p1 - 1));
+    }catch(const std::exception&) {
+        return false;
+    }
+    e.text = v.substr(p2 + 1);
+    return true;
+}
+///PROTOTYPE_LEAVE:IF_INCREMENTAL
+
+inline void doWalk(const size_t& printAstLevel, const bool& profile, TAG(Q_NSNAME)TAG(CLSNAME)& ymodule, std::vector<std::string> walkers, const std::filesystem::path& odir, const std::string_view& filename) {
     if(printAstLevel > 0) {
         ymodule.printAST(std::cout, printAstLevel, "");
         if(printAstLevel == 1) {
@@ -847,6 +2996,13 @@ inline void doWalk(const size_t& printAstLevel, TAG(Q_NSNAME)TAG(CLSNAME)& ymodu
             throw std::runtime_error("unknown walker: " + w);
         }
     }
+
+    if(profile == true) {
+        ymodule.stats.print(std::cout);
+
+        // the module is reused for the next input, which reports its own counts
+        ymodule.stats = {};
+    }
 }
 
 int main(int argc, char* argv[]) {
@@ -860,7 +3016,13 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> walkers;
     std::string odir = ".";
     std::string log;
+    std::string hotspotFile;
+    std::string traceFile;
+    ///PROTOTYPE_ENTER:IF_INCREMENTAL
+    std::vector<std::vector<TAG(Q_NSNAME)TAG(CLSNAME)::Edit>> updates;
+    ///PROTOTYPE_LEAVE:IF_INCREMENTAL
     bool verbose = false;
+    bool profile = false;
     size_t printAstLevel = 0;
 #if HAS_REPL
     bool repl = false;
@@ -921,6 +3083,47 @@ int main(int argc, char* argv[]) {
             printAstLevel = 1;
         }else if(a == "-t2") {
             printAstLevel = 2;
+#if HAS_PROFILER
+        }else if(a == "-p") {
+            profile = true;
+#endif
+        ///PROTOTYPE_ENTER:IF_HOTSPOTS
+        }else if(a == "-d") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid hotspot file");
+            }
+            hotspotFile = argv[i];
+        ///PROTOTYPE_LEAVE:IF_HOTSPOTS
+        ///PROTOTYPE_ENTER:IF_TRACE
+        }else if(a == "-b") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid trace file");
+            }
+            traceFile = argv[i];
+        ///PROTOTYPE_LEAVE:IF_TRACE
+        ///PROTOTYPE_ENTER:IF_INCREMENTAL
+        }else if(a == "-e") {
+            ++i;
+            if(i >= argc) {
+                return help(argv[0], "invalid edit");
+            }
+            std::string v = argv[i];
+            bool join = false;
+            if((v.size() > 0) && (v.front() == '+')) {
+                join = (updates.size() > 0);
+                v.erase(0, 1);
+            }
+            TAG(Q_NSNAME)TAG(CLSNAME)::Edit e;
+            if(parseEdit(v, e) == false) {
+                return help(argv[0], "invalid edit: " + v);
+            }
+            if(join == false) {
+                updates.emplace_back();
+            }
+            updates.back().push_back(std::move(e));
+        ///PROTOTYPE_LEAVE:IF_INCREMENTAL
         }else {
             return help(argv[0], "unknown argument: " + a);
         }
@@ -952,15 +3155,27 @@ int main(int argc, char* argv[]) {
     if(repl == false) {
         int errs = 0;
 
+        // instance of the module, reset before each input to reuse the memory of the previous one
+        TAG(Q_NSNAME)TAG(CLSNAME) ymodule("main", log);
+        ///PROTOTYPE_ENTER:IF_TRACE
+        TraceWriter tw(traceFile, ymodule);
+        ///PROTOTYPE_LEAVE:IF_TRACE
+
         // read all files
         for(auto& f : filenames) {
             if(verbose) std::print("compiling file: {}\n", f);
 
             try {
-                // instance of the module
-                TAG(Q_NSNAME)TAG(CLSNAME) ymodule("main", log);
-                ymodule.readFile(f);
-                doWalk(printAstLevel, ymodule, walkers, outf, f);
+                ymodule.reset();
+                ///PROTOTYPE_ENTER:IF_INCREMENTAL
+                if(updates.size() > 0) {
+                    readDocument(ymodule, loadFile(f), f, updates);
+                    doWalk(printAstLevel, profile, ymodule, walkers, outf, f);
+                    continue;
+                }
+                ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+                readFile(ymodule, f);
+                doWalk(printAstLevel, profile, ymodule, walkers, outf, f);
             }catch(const std::exception& ex) {
                 ++errs;
                 std::print("err:{}\n", ex.what());
@@ -975,15 +3190,30 @@ int main(int argc, char* argv[]) {
             if(verbose) std::print("compiling string: {}\n", inn);
 
             try {
-                // instance of the module
-                TAG(Q_NSNAME)TAG(CLSNAME) ymodule("main", log);
-                ymodule.readString(f, inn);
-                doWalk(printAstLevel, ymodule, walkers, "", "");
+                ymodule.reset();
+                ///PROTOTYPE_ENTER:IF_INCREMENTAL
+                if(updates.size() > 0) {
+                    readDocument(ymodule, f, inn, updates);
+                    doWalk(printAstLevel, profile, ymodule, walkers, "", "");
+                    continue;
+                }
+                ///PROTOTYPE_LEAVE:IF_INCREMENTAL
+                readString(ymodule, f, inn);
+                doWalk(printAstLevel, profile, ymodule, walkers, "", "");
             }catch(const std::exception& ex) {
                 std::print("err:{}\n", ex.what());
                 ++errs;
             }
         }
+
+        ///PROTOTYPE_ENTER:IF_HOTSPOTS
+        try {
+            writeHotspots(hotspotFile, ymodule);
+        }catch(const std::exception& ex) {
+            std::print("err:{}\n", ex.what());
+            ++errs;
+        }
+        ///PROTOTYPE_LEAVE:IF_HOTSPOTS
         return errs;
     }
 
@@ -991,14 +3221,18 @@ int main(int argc, char* argv[]) {
     if(repl == true) {
         // instance of the module
         TAG(Q_NSNAME)TAG(CLSNAME) ymodule("main", log);
+        ///PROTOTYPE_ENTER:IF_TRACE
+        TraceWriter tw(traceFile, ymodule);
+        ///PROTOTYPE_LEAVE:IF_TRACE
 
         // read all files
         for(auto& f : filenames) {
             if(verbose) std::print("compiling file: {}\n", f);
 
             try {
-                ymodule.readFile(f);
-                doWalk(printAstLevel, ymodule, walkers, "", "");
+                ymodule.reset();
+                readFile(ymodule, f);
+                doWalk(printAstLevel, profile, ymodule, walkers, "", "");
             }catch(const std::exception& ex) {
                 std::print("err:{}\n", ex.what());
             }
@@ -1010,8 +3244,9 @@ int main(int argc, char* argv[]) {
             if(verbose) std::print("compiling string\n", f);
 
             try {
-                ymodule.readString(f, "<str>");
-                doWalk(printAstLevel, ymodule, walkers, "", "");
+                ymodule.reset();
+                readString(ymodule, f, "<str>");
+                doWalk(printAstLevel, profile, ymodule, walkers, "", "");
             }catch(const std::exception& ex) {
                 std::print("err:{}\n", ex.what());
             }
@@ -1029,6 +3264,14 @@ int main(int argc, char* argv[]) {
                 std::print("err:{}\n", ex.what());
             }
         }
+
+        ///PROTOTYPE_ENTER:IF_HOTSPOTS
+        try {
+            writeHotspots(hotspotFile, ymodule);
+        }catch(const std::exception& ex) {
+            std::print("err:{}\n", ex.what());
+        }
+        ///PROTOTYPE_LEAVE:IF_HOTSPOTS
     }
 #endif
 
@@ -12,6 +12,10 @@ struct Stream {
     char_t ch = 1;
     bool _eof = false;
 
+    // true while more data may be appended to `in`
+    // the stream then ends at the end of the available data instead of returning EOF
+    bool partial = false;
+
     ///PROTOTYPE_ENTER:SKIP
     static inline char_t read(std::istream& in) {
         return in.peek();
@@ -52,6 +56,24 @@ struct Stream {
             pos.row++;
             pos.col = 1;
         }
+        if((static_cast<int>(ch) == EOF) && (partial == true)) {
+            _eof = true;
+        }
+    }
+
+    inline void setPartial(const bool& p) {
+        partial = p;
+        _eof = ((partial == true) && (static_cast<int>(ch) == EOF));
+    }
+
+    // continue after more data was appended to `in`
+    inline void resume() {
+        ch = read(in);
+        if(ch == '\n') {
+            pos.row++;
+            pos.col = 1;
+        }
+        setPartial(partial);
     }
 };
 
@@ -0,0 +1,139 @@
+#include "pch.hpp"
+#include "timing.hpp"
+#include "print.hpp"
+
+namespace {
+/// @brief return the peak resident set size of this process since the last resetPeak(), in KB
+/// linux keeps it as VmHWM in /proc/self/status
+inline auto getPeakKB() -> size_t {
+    std::ifstream is("/proc/self/status");
+    std::string line;
+    while(std::getline(is, line)) {
+        if(line.starts_with("VmHWM:")) {
+            return static_cast<size_t>(std::stoull(line.substr(6))); // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+        }
+    }
+    return 0;
+}
+
+/// @brief return @arg s as a quoted JSON string
+inline auto jsonString(const std::string& s) -> std::string {
+    std::string rv = "\"";
+    for(const auto& ch : s) {
+        switch(ch) {
+        case '"':
+            rv += "\\\"";
+            break;
+        case '\\':
+            rv += "\\\\";
+            break;
+        case '\n':
+            rv += "\\n";
+            break;
+        default:
+            if(static_cast<unsigned char>(ch) < 0x20) { // NOLINT(cppcoreguidelines-avoid-magic-numbers,readability-magic-numbers)
+                rv += std::format("\\u{:04x}", static_cast<unsigned>(ch));
+            }else{
+                rv += ch;
+            }
+            break;
+        }
+    }
+    rv += "\"";
+    return rv;
+}
+
+/// @brief return the segments sorted by file, keeping the order within each file
+inline auto getSortedSegments(const std::vector<Timing::Segment>& segments) -> std::vector<Timing::Segment> {
+    auto sorted = segments;
+    std::ranges::stable_sort(sorted, [](const Timing::Segment& lhs, const Timing::Segment& rhs) {
+        return lhs.file < rhs.file;
+    });
+    return sorted;
+}
+
+/// @brief return the files sorted by name
+inline auto getSortedFiles(const std::vector<Timing::File>& files) -> std::vector<Timing::File> {
+    auto sorted = files;
+    std::ranges::sort(sorted, [](const Timing::File& lhs, const Timing::File& rhs) {
+        return lhs.file < rhs.file;
+    });
+    return sorted;
+}
+}
+
+bool Timing::resetPeak() {
+#if defined(__linux__)
+    // writing 5 to clear_refs resets VmHWM to the current resident set size
+    std::ofstream os("/proc/self/clear_refs");
+    os << "5";
+    os.flush();
+    return os.good();
+#else
+    return false;
+#endif
+}
+
+void Timing::addPhase(const std::string& name, const double& ms, const bool& measured) {
+    phases.push_back(Phase{name, ms, (measured == true) ? getPeakKB() : 0});
+}
+
+void Timing::print(std::ostream& os) const {
+    std::println(os, "TIMING");
+    std::println(os, "{:<24} {:>12} {:>14}", "phase", "ms", "peak-rss(KB)");
+    for(const auto& p : phases) {
+        std::println(os, "{:<24} {:>12.3f} {:>14}", p.name, p.ms, p.peakKB);
+    }
+
+    std::println(os, "{:<24} {:>12}", "count", "value");
+    for(const auto& c : counts) {
+        std::println(os, "{:<24} {:>12}", c.first, c.second);
+    }
+
+    std::println(os, "{:<40} {:>12} {:>12}", "file", "lines", "bytes");
+    for(const auto& f : getSortedFiles(files)) {
+        std::println(os, "{:<40} {:>12} {:>12}", f.file, f.lines, f.bytes);
+    }
+
+    std::println(os, "{:<40} {:<24} {:>12} {:>12}", "file", "segment", "lines", "bytes");
+    for(const auto& s : getSortedSegments(segments)) {
+        std::println(os, "{:<40} {:<24} {:>12} {:>12}", s.file, s.name, s.lines, s.bytes);
+    }
+}
+
+void Timing::printJson(std::ostream& os) const {
+    std::string sep;
+    std::println(os, "{{");
+
+    std::println(os, "  \"phases\": [");
+    for(const auto& p : phases) {
+        std::print(os, "{}    {{\"name\": {}, \"ms\": {:.3f}, \"peak_rss_kb\": {}}}", sep, jsonString(p.name), p.ms, p.peakKB);
+        sep = ",\n";
+    }
+    std::println(os, "\n  ],");
+
+    sep.clear();
+    std::println(os, "  \"counts\": {{");
+    for(const auto& c : counts) {
+        std::print(os, "{}    {}: {}", sep, jsonString(c.first), c.second);
+        sep = ",\n";
+    }
+    std::println(os, "\n  }},");
+
+    sep.clear();
+    std::println(os, "  \"files\": [");
+    for(const auto& f : getSortedFiles(files)) {
+        std::print(os, "{}    {{\"file\": {}, \"lines\": {}, \"bytes\": {}}}", sep, jsonString(f.file), f.lines, f.bytes);
+        sep = ",\n";
+    }
+    std::println(os, "\n  ],");
+
+    sep.clear();
+    std::println(os, "  \"segments\": [");
+    for(const auto& s : getSortedSegments(segments)) {
+        std::print(os, "{}    {{\"file\": {}, \"segment\": {}, \"lines\": {}, \"bytes\": {}}}", sep, jsonString(s.file), jsonString(s.name), s.lines, s.bytes);
+        sep = ",\n";
+    }
+    std::println(os, "\n  ]");
+    std::println(os, "}}");
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "nsutil.hpp"
+
+/// @brief collects the phase timings and sizes reported by `-j +timing`
+/// Phases are timed unconditionally, which is cheap. The report is only
+/// written when timing is enabled.
+struct Timing {
+    /// @brief wall time and peak memory of one phase of ycc
+    struct Phase {
+        std::string name;
+        double ms = 0;
+
+        /// @brief peak resident set size of the process during this phase only, in KB
+        /// the peak is reset when the phase starts, 0 where the platform cannot reset it
+        size_t peakKB = 0;
+    };
+
+    /// @brief size of one ///PROTOTYPE_SEGMENT in a generated file
+    struct Segment {
+        std::string file;
+        std::string name;
+        size_t lines = 0;
+        size_t bytes = 0;
+    };
+
+    /// @brief size of one generated file
+    struct File {
+        std::string file;
+        size_t lines = 0;
+        size_t bytes = 0;
+    };
+
+    /// @brief times a phase from construction to destruction
+    struct Scope : public NonCopyable {
+        Timing& timing;
+        std::string name;
+        std::chrono::steady_clock::time_point start;
+
+        /// @brief true if the peak resident set size was reset when the phase started
+        bool measured;
+
+        inline Scope(Timing& t, const std::string& n) : timing(t), name(n), start(std::chrono::steady_clock::now()), measured(resetPeak()) {}
+
+        inline ~Scope() {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            timing.addPhase(name, elapsed.count(), measured);
+        }
+    };
+
+    std::vector<Phase> phases;
+    std::vector<std::pair<std::string, size_t>> counts;
+    std::vector<Segment> segments;
+    std::vector<File> files;
+
+    /// @brief guards segments and files, which are added by the generator threads
+    std::mutex mutex;
+
+    /// @brief start timing a phase named @arg name
+    inline auto phase(const std::string& name) -> Scope {
+        return Scope(*this, name);
+    }
+
+    /// @brief reset the peak resident set size of the process to its current size
+    /// returns false where the platform does not support it
+    static bool resetPeak();
+
+    /// @brief add a phase, with the peak resident set size since resetPeak() if @arg measured
+    void addPhase(const std::string& name, const double& ms, const bool& measured);
+
+    inline void addCount(const std::string& name, const size_t& count) {
+        counts.emplace_back(name, count);
+    }
+
+    inline void addFile(const std::string& file, const size_t& lines, const size_t& bytes) {
+        std::lock_guard lock(mutex);
+        files.push_back(File{file, lines, bytes});
+    }
+
+    inline void addSegment(const std::string& file, const std::string& name, const size_t& lines, const size_t& bytes) {
+        std::lock_guard lock(mutex);
+        segments.push_back(Segment{file, name, lines, bytes});
+    }
+
+    /// @brief print a human-readable report to @arg os
+    void print(std::ostream& os) const;
+
+    /// @brief write the report as JSON to @arg os
+    void printJson(std::ostream& os) const;
+};
+
+auto timing() -> Timing&;
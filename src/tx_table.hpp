@@ -4,44 +4,51 @@ template<typename RowT, typename ColT, typename CellT>
 struct Table {
     struct Row {
         std::string name;
-        std::vector<std::pair<ColT, CellT>> cols;
+
+        /// @brief cells of this row, indexed by header position
+        /// an empty cell has not been set
+        std::vector<CellT> cells;
+
         inline void addCell(Table& t, const ColT& col, const CellT& val) {
-            for(auto& c : cols) {
-                if(c.first == col) {
-                    assert(c.second == val);
-                    return;
-                }
+            auto hit = t.headerIndex.find(col);
+            assert(hit != t.headerIndex.end());
+            auto idx = hit->second;
+            if(idx >= cells.size()) {
+                cells.resize(t.headers.size());
             }
-            cols.push_back(std::make_pair(col, val));
-            for(auto& h : t.headers) {
-                if(h.first == col) {
-                    if(val.size() > h.second) {
-                        h.second = val.size();
-                    }
-                    return;
-                }
+            if(cells.at(idx).empty() == false) {
+                assert(cells.at(idx) == val);
+                return;
+            }
+            cells.at(idx) = val;
+            auto& h = t.headers.at(idx);
+            if(val.size() > h.second) {
+                h.second = val.size();
             }
-            assert(false);
         }
     };
     std::vector<std::pair<ColT, size_t>> headers;
     std::vector<std::pair<RowT, Row>> rows;
 
+    /// @brief position of each header in headers
+    std::unordered_map<ColT, size_t> headerIndex;
+
+    /// @brief position of each row in rows
+    std::unordered_map<RowT, size_t> rowIndex;
+
     inline void addHeader(const std::string& name) {
-        for(auto& h : headers) {
-            if(h.first == name) {
-                return;
-            }
+        if(headerIndex.contains(name) == true) {
+            return;
         }
+        headerIndex[name] = headers.size();
         headers.push_back(std::make_pair(name, name.size()));
     }
 
     inline Row& addRow(const RowT& row, const std::string& name) {
-        for(auto& r : rows) {
-            if(r.first == row) {
-                return r.second;
-            }
+        if(auto rit = rowIndex.find(row); rit != rowIndex.end()) {
+            return rows.at(rit->second).second;
         }
+        rowIndex[row] = rows.size();
         rows.push_back(std::make_pair(row, Row()));
         auto& nrow = rows.back();
         nrow.second.name = name;
@@ -64,15 +71,12 @@ struct Table {
 
         for(auto& r : rows) {
             hs << std::format("|{}|", r.second.name);
-            for(auto& h : headers) {
+            for(size_t idx = 0; idx < headers.size(); ++idx) {
+                auto& h = headers.at(idx);
                 std::string cell;
-                for(auto& c : r.second.cols) {
-                    if(h.first == c.first) {
-                        cell = centre(c.second, h.second);
-                        break;
-                    }
-                }
-                if(cell.empty()) {
+                if(idx < r.second.cells.size()) {
+                    cell = centre(r.second.cells.at(idx), h.second);
+                }else{
                     cell = centre("", h.second);
                 }
                 hs << std::format("{}|", cell);
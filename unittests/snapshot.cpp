@@ -0,0 +1,183 @@
+// test driver for snapshot() and restore(), built by unittests.sh
+// against a module generated with ycc -i from a grammar with %class Snap
+// reads the input passed on the command line in chunks, restores the snapshots taken before them
+// and expects the same AST and positions as readString(), prints each mismatch and returns their number
+// the grammar must be a left-recursive list of items, for checking the items reported by completedItems()
+#include "snap.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <format>
+#include <functional>
+
+namespace {
+int failed = 0;
+
+inline void check(const bool& ok, const std::string& what) {
+    if(ok == false) {
+        ++failed;
+        std::cout << "FAIL:" << what << std::endl;
+    }
+}
+
+inline std::string printAST(const Snap& m) {
+    std::ostringstream ss;
+    m.printAST(ss, 2, "");
+    return ss.str();
+}
+
+inline std::string readString(Snap& m, const std::string& text) {
+    try {
+        m.readString(text, "a1.in");
+    }catch(const std::exception& ex) {
+        return std::string("err:") + ex.what();
+    }
+    return printAST(m);
+}
+
+// read @arg chunks from @arg from to the end of the stream, taking a snapshot before each chunk into @arg snaps
+// and adding the items completed by the chunks to @arg items
+inline std::string readChunks(Snap& m, const std::vector<std::string>& chunks, const size_t& from, std::vector<Snap::Snapshot>& snaps, size_t* items = nullptr) {
+    try {
+        for(size_t i = from; i < chunks.size(); ++i) {
+            snaps.push_back(m.snapshot());
+            m.readChunk(chunks.at(i), "a1.in");
+            if(items != nullptr) {
+                *items += m.completedItems();
+            }
+        }
+        m.endStream();
+    }catch(const std::exception& ex) {
+        return std::string("err:") + ex.what();
+    }
+    return printAST(m);
+}
+
+inline bool throws(const std::function<void()>& fn) {
+    try {
+        fn();
+    }catch(const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+inline std::vector<std::string> splitSize(const std::string& text, const size_t& size) {
+    std::vector<std::string> chunks;
+    for(size_t i = 0; i < text.size(); i += size) {
+        chunks.push_back(text.substr(i, size));
+    }
+    return chunks;
+}
+
+inline std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> chunks;
+    size_t i = 0;
+    while(i < text.size()) {
+        auto e = text.find('\n', i);
+        e = (e == std::string::npos) ? text.size() : e + 1;
+        chunks.push_back(text.substr(i, e - i));
+        i = e;
+    }
+    return chunks;
+}
+
+// read the chunks with a snapshot before each, which may be inside a token or a UTF-8 sequence,
+// then restore the snapshots from the last to the first and read the rest of the stream again after each
+// each of the @arg xitems items is reported once, all but the last two by the chunks, since an item is completed by
+// the token after it, and the last token may only end when endStream() sees the EOF
+inline void testRoundTrip(Snap& m, const std::string& text, const std::string& xast, const size_t& xitems, const size_t& size) {
+    auto chunks = splitSize(text, size);
+    std::vector<Snap::Snapshot> snaps;
+    std::vector<Snap::Snapshot> rsnaps;
+    m.beginStream();
+    size_t items = 0;
+    check(readChunks(m, chunks, 0, snaps, &items) == xast, std::format("chunks of {}", size));
+    if(xitems > 0) {
+        check(items + 2 >= xitems, std::format("chunks of {}, {} items completed before endStream()", size, items));
+        check(items + m.completedItems() == xitems, std::format("chunks of {}, items completed by endStream()", size));
+    }
+
+    // after an error, there are only snapshots up to the chunk that failed
+    for(size_t j = snaps.size(); j > 0; --j) {
+        m.restore(snaps.at(j - 1));
+        rsnaps.clear();
+        check(readChunks(m, chunks, j - 1, rsnaps) == xast, std::format("chunks of {}, restored before chunk {}", size, j - 1));
+    }
+}
+
+// restore the snapshot before each line, read an edited line and the lines after it,
+// then check which of the old and new snapshots are still valid
+// a token must end in each line, so that the edited line overwrites the parser values of the lines after it
+inline void testLines(Snap& m, const std::string& text) {
+    auto lines = splitLines(text);
+    for(size_t j = 0; j < lines.size(); ++j) {
+        std::vector<Snap::Snapshot> snaps;
+        auto xast = readString(m, text);
+        m.beginStream();
+        check(readChunks(m, lines, 0, snaps) == xast, "lines");
+        if(j >= snaps.size()) {
+            break;
+        }
+
+        // an edit to line j, which adds a token at the start of it
+        auto edited = lines;
+        edited.at(j) = "zz " + edited.at(j);
+        std::string etext;
+        for(auto& l : edited) {
+            etext += l;
+        }
+        auto east = readString(m, etext);
+        check(throws([&m, &snaps, &j]() { m.restore(snaps.at(j)); }) == true, std::format("snapshot of line {} restored after another stream", j));
+
+        m.beginStream();
+        snaps.clear();
+        check(readChunks(m, lines, 0, snaps) == xast, "lines");
+        m.restore(snaps.at(j));
+        std::vector<Snap::Snapshot> esnaps;
+        check(readChunks(m, edited, j, esnaps) == east, std::format("edited line {}", j));
+
+        // the snapshots after line j in the old run have been overwritten by the edited line
+        for(size_t k = j + 1; k < snaps.size(); ++k) {
+            check(throws([&m, &snaps, &k]() { m.restore(snaps.at(k)); }) == true, std::format("overwritten snapshot of line {} after editing line {}", k, j));
+        }
+
+        // the snapshots taken after restore() are valid, and so are the old ones up to line j
+        for(size_t k = esnaps.size(); k > 0; --k) {
+            m.restore(esnaps.at(k - 1));
+            std::vector<Snap::Snapshot> rsnaps;
+            check(readChunks(m, edited, j + k - 1, rsnaps) == east, std::format("new snapshot of line {} after editing line {}", j + k - 1, j));
+        }
+        for(size_t k = j + 1; k > 0; --k) {
+            m.restore(snaps.at(k - 1));
+            std::vector<Snap::Snapshot> rsnaps;
+            check(readChunks(m, lines, k - 1, rsnaps) == xast, std::format("old snapshot of line {} after editing line {}", k - 1, j));
+        }
+    }
+}
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        std::cout << "usage: snapshot <input>" << std::endl;
+        return 1;
+    }
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage begin
+#endif
+    std::string text = argv[1];
+#if defined(__clang__)
+#pragma clang unsafe_buffer_usage end
+#endif
+
+    Snap m("snapshot");
+    auto xast = readString(m, text);
+    size_t xitems = (xast.starts_with("err:") == true) ? 0 : m.completedItems();
+    check((xast.starts_with("err:") == true) || (xitems > 0), "items completed by readString()");
+    for(size_t size = 1; size <= 4; ++size) {
+        testRoundTrip(m, text, xast, xitems, size);
+    }
+    testLines(m, text);
+    return failed;
+}
@@ -48,6 +48,8 @@ else
   OUT="/tmp/a.out"
 fi
 
+TESTDIR=$(dirname "$0")
+
 if [ ! -f ${YCC} ]; then
   echo "YCC executable not found at ${YCC}"
   exit 1
@@ -68,13 +70,15 @@ compile_grammar() {
 
   grammar="$1"
   xerr="$2" #0 - expect success, 1 = expect ycc-error, 2 = expect compile-error
+  yflags="$3" # extra ycc flags, e.g. -x
+  cflags="$4" # extra compiler flags, e.g. -DPARALLEL_CHUNK=8
 
   if [ $verbose -eq 1 ]; then
     echo ${BASH_LINENO}: Generating parser
   fi
 
   # generate parser code
-  ${YCC} -c ascii -s "$grammar" -a -n out -g out.md
+  ${YCC} -c ascii -s "$grammar" -a -n out -g out.md $yflags
   if [ $? -ne 0 ]; then
     if [ $xerr -eq 1 ]; then
       return
@@ -94,7 +98,7 @@ compile_grammar() {
   fi
 
   # compile the generated code
-  ${CC} $FLAGS out.cpp
+  ${CC} $FLAGS $cflags out.cpp
 
   # check for expected compile error
   if [ $? -ne 0 ]; then
@@ -197,6 +201,161 @@ run_failing_test() {
   fi
 }
 
+# reads the input with -s (readString) and from the file a1.in (readFile)
+# and expects the same AST and positions, or the same error, from both
+run_file_test() {
+  local OPTIND OPTARG opt input soutput foutput sstatus fstatus
+  if [ $enabled -eq 0 ]; then
+    return
+  fi
+
+  OPTIND=1
+  input=""
+
+  while getopts "s:" opt "$@"; do
+    case "$opt" in
+      s)
+        input="$OPTARG"
+        ;;
+    esac
+  done
+
+  echo -n "${BASH_LINENO}: Running file test [${input//$'\n'/\\n}]... "
+  printf '%s' "$input" > a1.in
+  soutput=$("$OUT" -s "$input" -l "$logger" -t2)
+  sstatus=$?
+  foutput=$("$OUT" -f a1.in -l "$logger" -t2)
+  fstatus=$?
+  if [ "$soutput" != "$foutput" ] || [ $sstatus -ne $fstatus ]; then
+    echo "STR : [$soutput]"
+    echo "FILE: [$foutput]"
+    if [ $failfast -ne 0 ]; then
+      echo "${BASH_LINENO}: Exiting on failure-file output differs"
+      exit 1
+    fi
+    failcount=$((failcount+1))
+    echo "FAIL"
+  else
+    passcount=$((passcount+1))
+    echo "PASS"
+  fi
+}
+
+# reads the input with readDocument() and applies the edits with updateDocument() (-e),
+# and expects the same AST and positions, or the same error, as reading the edited text with readString() (-x)
+run_edit_test() {
+  local OPTIND OPTARG opt input edited edits uoutput soutput ustatus sstatus
+  if [ $enabled -eq 0 ]; then
+    return
+  fi
+
+  OPTIND=1
+  input=""
+  edited=""
+  edits=()
+
+  while getopts "s:x:e:" opt "$@"; do
+    case "$opt" in
+      s)
+        input="$OPTARG"
+        ;;
+      x)
+        edited="$OPTARG"
+        ;;
+      e)
+        edits+=(-e "$OPTARG")
+        ;;
+    esac
+  done
+
+  echo -n "${BASH_LINENO}: Running edit test [${edited//$'\n'/\\n}]... "
+  uoutput=$("$OUT" -s "$input" "${edits[@]}" -l "$logger" -t2)
+  ustatus=$?
+  soutput=$("$OUT" -s "$edited" -l "$logger" -t2)
+  sstatus=$?
+  if [ "$uoutput" != "$soutput" ] || [ $ustatus -ne $sstatus ]; then
+    echo "STR : [$soutput]"
+    echo "EDIT: [$uoutput]"
+    if [ $failfast -ne 0 ]; then
+      echo "${BASH_LINENO}: Exiting on failure-edited output differs"
+      exit 1
+    fi
+    failcount=$((failcount+1))
+    echo "FAIL"
+  else
+    passcount=$((passcount+1))
+    echo "PASS"
+  fi
+}
+
+# generates snap.hpp and snap.cpp with -i and builds them with the snapshot() and restore() test driver
+compile_snapshot_driver() {
+  if [ $enabled -eq 0 ]; then
+    return
+  fi
+
+  grammar="$1"
+  cflags="$2" # extra compiler flags
+
+  ${YCC} -s "$grammar" -i -n snap
+  if [ $? -ne 0 ]; then
+    if [ $failfast -ne 0 ]; then
+        echo ${BASH_LINENO}: Exiting on failure-ycc failed
+        echo $grammar
+        exit 1
+    fi
+    failcount=$((failcount+1))
+    return
+  fi
+  passcount=$((passcount+1))
+
+  ${CC} $FLAGS $cflags -I . snap.cpp "$TESTDIR/snapshot.cpp"
+  if [ $? -ne 0 ]; then
+    if [ $failfast -ne 0 ]; then
+        echo ${BASH_LINENO}: Exiting on failure: compile failed
+        exit 1
+    fi
+    failcount=$((failcount+1))
+  else
+    passcount=$((passcount+1))
+  fi
+}
+
+# reads the input in chunks with the driver built by compile_snapshot_driver(), restoring the snapshots taken before them
+# and expects the same AST and positions as readString() after each restore()
+run_snapshot_test() {
+  local OPTIND OPTARG opt input routput
+  if [ $enabled -eq 0 ]; then
+    return
+  fi
+
+  OPTIND=1
+  input=""
+
+  while getopts "s:" opt "$@"; do
+    case "$opt" in
+      s)
+        input="$OPTARG"
+        ;;
+    esac
+  done
+
+  echo -n "${BASH_LINENO}: Running snapshot test [${input//$'\n'/\\n}]... "
+  routput=$("$OUT" "$input")
+  if [ $? -ne 0 ]; then
+    echo "$routput"
+    if [ $failfast -ne 0 ]; then
+      echo "${BASH_LINENO}: Exiting on failure-snapshot test failed"
+      exit 1
+    fi
+    failcount=$((failcount+1))
+    echo "FAIL"
+  else
+    passcount=$((passcount+1))
+    echo "PASS"
+  fi
+}
+
 #############################
 grammar='
 start := stmts;
@@ -1218,7 +1377,8 @@ WS := "\s"!;
 
 compile_grammar "$grammar" 0
 run_passing_test -s 'xx = 11 + 12 + 13;' -t '0:start_1(1:stmts_2(2:stmt_1(3:ID(xx) 3:EQ(=) 3:expr_1(4:expr_1(5:expr_3(6:NUM(11)) 5:PLUS(+) 5:expr_3(6:NUM(12))) 4:PLUS(+) 4:expr_3(5:NUM(13))) 3:SEMI(;))) 1:_tEND())'
-run_passing_test -s 'xx = 11 * 12 * 13;' -t '0:start_1(1:stmts_2(2:stmt_1(3:ID(xx) 3:EQ(=) 3:expr_2(4:expr_2(5:expr_3(6:NUM(11)) 5:STAR(*) 5:expr_3(6:NUM(12))) 4:STAR(*) 4:expr_3(5:NUM(13))) 3:SEMI(;))) 1:_tEND())'
+# STAR is defined with :=, which makes it right-associative, PLUS with :=> is left-associative
+run_passing_test -s 'xx = 11 * 12 * 13;' -t '0:start_1(1:stmts_2(2:stmt_1(3:ID(xx) 3:EQ(=) 3:expr_2(4:expr_3(5:NUM(11)) 4:STAR(*) 4:expr_2(5:expr_3(6:NUM(12)) 5:STAR(*) 5:expr_3(6:NUM(13)))) 3:SEMI(;))) 1:_tEND())'
 
 #############################
 grammar='
@@ -1500,6 +1660,202 @@ compile_grammar "$grammar" 0
 run_passing_test -s '1 + 2' -t '0:start_1(1:expr_1(2:expr_5(3:NUMBER(1)) 2:PLUS(+) 2:expr_5(3:NUMBER(2))) 1:_tEND())'
 run_passing_test -s '1 - 23' -t '0:start_1(1:expr_2(2:expr_5(3:NUMBER(1)) 2:MINUS(-) 2:expr_5(3:NUMBER(23))) 1:_tEND())'
 
+#############################
+# LALR(1) but not SLR(1): EQ is in FOLLOW(r),
+# but r cannot be reduced before EQ at the start of s
+grammar='
+start := s;
+s := l EQ r;
+s := r;
+l := STAR r;
+l := ID;
+r := l;
+
+EQ := "=";
+STAR := "\*";
+ID := "[a-z]+";
+WS := "\s"!;
+'
+
+compile_grammar "$grammar" 0
+run_passing_test -s 'a' -t '0:start_1(1:s_2(2:r_1(3:l_2(4:ID(a)))) 1:_tEND())'
+run_passing_test -s '*a = *b' -t '0:start_1(1:s_1(2:l_1(3:STAR(*) 3:r_1(4:l_2(5:ID(a)))) 2:EQ(=) 2:r_1(3:l_1(4:STAR(*) 4:r_1(5:l_2(6:ID(b)))))) 1:_tEND())'
+run_failing_test -s 'a = = b'
+
+#############################
+# a rule that starts with the token that is shifted into it
+# must be in the closure of the state after the token
+grammar='
+start := expr;
+expr := expr PLUS term;
+expr := term;
+term := LPAREN expr RPAREN;
+term := NUMBER;
+
+%left PLUS;
+NUMBER := "\d+";
+PLUS := "\+";
+LPAREN := "\(";
+RPAREN := "\)";
+WS := "\s"!;
+'
+
+compile_grammar "$grammar" 0
+run_passing_test -s '((1))' -t '0:start_1(1:expr_2(2:term_1(3:LPAREN(() 3:expr_2(4:term_1(5:LPAREN(() 5:expr_2(6:term_2(7:NUMBER(1))) 5:RPAREN()))) 3:RPAREN()))) 1:_tEND())'
+run_passing_test -s '1+((2))' -t '0:start_1(1:expr_1(2:expr_2(3:term_2(4:NUMBER(1))) 2:PLUS(+) 2:term_1(3:LPAREN(() 3:expr_2(4:term_1(5:LPAREN(() 5:expr_2(6:term_2(7:NUMBER(2))) 5:RPAREN()))) 3:RPAREN()))) 1:_tEND())'
+run_failing_test -s '((1)'
+
+#############################
+# units parsed on their own and shifted by readUnits(),
+# a unit that does not parse on its own is parsed token by token
+grammar='
+%parallel_units SEMI decl;
+
+start := decls;
+decls := decls decl;
+decls := decl;
+decl := ID EQ ID SEMI;
+decl := ID LCURLY decls RCURLY;
+
+EQ := "=";
+SEMI := ";";
+LCURLY := "\{";
+RCURLY := "\}";
+ID := "[a-z]+";
+WS := "\s"!;
+'
+
+compile_grammar "$grammar" 0
+run_passing_test -s 'a=b;' -t '0:start_1(1:decls_2(2:decl_1(3:ID(a) 3:EQ(=) 3:ID(b) 3:SEMI(;))) 1:_tEND())'
+run_passing_test -s 'a=b; c=d; e=f;' -t '0:start_1(1:decls_1(2:decls_1(3:decls_2(4:decl_1(5:ID(a) 5:EQ(=) 5:ID(b) 5:SEMI(;))) 3:decl_1(4:ID(c) 4:EQ(=) 4:ID(d) 4:SEMI(;))) 2:decl_1(3:ID(e) 3:EQ(=) 3:ID(f) 3:SEMI(;))) 1:_tEND())'
+run_passing_test -s 'a=b; x{c=d;} e=f;' -t '0:start_1(1:decls_1(2:decls_1(3:decls_2(4:decl_1(5:ID(a) 5:EQ(=) 5:ID(b) 5:SEMI(;))) 3:decl_2(4:ID(x) 4:LCURLY({) 4:decls_2(5:decl_1(6:ID(c) 6:EQ(=) 6:ID(d) 6:SEMI(;))) 4:RCURLY(}))) 2:decl_1(3:ID(e) 3:EQ(=) 3:ID(f) 3:SEMI(;))) 1:_tEND())'
+run_failing_test -s 'a=b; c=;'
+run_failing_test -s 'a=b; c d; e=f;'
+
+#############################
+# %parallel_units can only be given once
+grammar='
+%parallel_units SEMI decl;
+%parallel_units SEMI decl;
+
+start := decls;
+decls := decls decl;
+decls := decl;
+decl := ID SEMI;
+
+SEMI := ";";
+ID := "[a-z]+";
+WS := "\s"!;
+'
+
+compile_grammar "$grammar" 1
+
+#############################
+# readParallel() with 8 byte chunks on 3 threads, -f reads a1.in with readParallel() and -s with readString()
+# tokens split by a chunk boundary, and chunks that start inside a string or a comment, where the scan
+# from the start of the chunk is wrong and the chunk is scanned again after the previous one
+grammar='
+start := items;
+items := items item;
+items := item;
+item := ID;
+item := STR;
+
+ID := "[a-z]+";
+STR := "\"[^\"]*\"";
+ENTER_MLCOMMENT := "/\*"! [ML_COMMENT_MODE];
+WS := "\s"!;
+
+%lexer_mode ML_COMMENT_MODE;
+ENTER_MLCOMMENT := "/\*"! [ML_COMMENT_MODE];
+LEAVE_MLCOMMENT := "\*/"! [^];
+CMT := ".*"!;
+'
+
+compile_grammar "$grammar" 0 "-x" "-DPARALLEL_CHUNK=8 -DPARALLEL_THREADS=3"
+run_file_test -s $'abcdefghijkl mnopqrstuvw\nxyz\nab cd\n'
+run_file_test -s $'abc def\nghi "jk\nlm" nop\nqrs tuv\nwxyz\nab cd\nef gh\n'
+run_file_test -s $'abc def ghi\n/* xx\nyy zz\n ww */ ab\ncd ef gh\nij\nkl mn\n'
+run_file_test -s $'abc def ghi\n/* xx /* yy\nzz */\nww */ ab\ncd ef\ngh\n'
+run_file_test -s $'abc def ghi\n"xx\nyy zz\nww" ab\ncd "ef gh\nij\nkl mn\nop qr st uv"\nwx\n'
+run_file_test -s $'abc def ghi\njkl mno\npqr "stu\nvwx\n'
+run_file_test -s $'abc def ghi\njkl mno\npqr stu\nvwx\nAB\n'
+
+#############################
+# updateDocument() with a checkpoint every 2 lines, against readString() of the edited text
+# the same grammar as above, generated with -i
+compile_grammar "$grammar" 0 "-i" "-DDOCUMENT_CHECKPOINT_LINES=2"
+doc=$'ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+
+# insert, delete and replace within a line
+run_edit_test -s "$doc" -e '23,0,xyz ' -x $'ab cd\nef "gh"\nij\nkl mn\nxyz op\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '17,3,' -x $'ab cd\nef "gh"\nij\nmn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '26,2,xx' -x $'ab cd\nef "gh"\nij\nkl mn\nop\nxx st\nuv\nwx yz\n'
+
+# edits that add and remove lines, which move the rows of the tokens after them
+run_edit_test -s "$doc" -e $'3,0,aa\nbb\ncc ' -x $'ab aa\nbb\ncc cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '6,17,' -x $'ab cd\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e $'19,1,\n' -x $'ab cd\nef "gh"\nij\nkl\nmn\nop\nqr st\nuv\nwx yz\n'
+
+# edits inside a string, which may end it early or leave it open
+run_edit_test -s "$doc" -e '10,1,z' -x $'ab cd\nef "zh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e $'10,0,x\ny' -x $'ab cd\nef "x\nygh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '10,0,x" "' -x $'ab cd\nef "x" "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '12,1,' -x $'ab cd\nef "gh\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '9,0,"' -x $'ab cd\nef ""gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+
+# edits at the start and at the end of the document
+run_edit_test -s "$doc" -e '0,0,zz ' -x $'zz ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '41,0,ab' -x $'ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\nab'
+run_edit_test -s "$doc" -e '39,2,' -x $'ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx y'
+run_edit_test -s "$doc" -e '41,0,/* xx' -x $'ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx yz\n/* xx'
+
+# edits in several places in one update, and several updates one after the other
+run_edit_test -s "$doc" -e '3,2,xx' -e '+26,0,z' -e '+39,0,/* zz */' -x $'ab xx\nef "gh"\nij\nkl mn\nop\nzqr st\nuv\nwx /* zz */yz\n'
+run_edit_test -s "$doc" -e '38,0,"' -e '+0,0,"' -x $'"ab cd\nef "gh"\nij\nkl mn\nop\nqr st\nuv\nwx "yz\n'
+run_edit_test -s "$doc" -e '3,2,xx' -e '26,0,z' -e $'6,0,\n\n' -x $'ab xx\n\n\nef "gh"\nij\nkl mn\nop\nzqr st\nuv\nwx yz\n'
+run_edit_test -s "$doc" -e '12,1,' -e '12,0,"' -x "$doc"
+run_edit_test -s "$doc" -e '3,0,1' -e '3,1,' -x "$doc"
+
+# a single line document, with a checkpoint every 3 tokens
+compile_grammar "$grammar" 0 "-i" "-DDOCUMENT_CHECKPOINT_TOKENS=3"
+doc='ab cd ef "gh ij" kl mn op qr st uv wx'
+run_edit_test -s "$doc" -e '26,0,zz ' -x 'ab cd ef "gh ij" kl mn op zz qr st uv wx'
+run_edit_test -s "$doc" -e '13,1,' -x 'ab cd ef "gh j" kl mn op qr st uv wx'
+run_edit_test -s "$doc" -e '15,1,' -x 'ab cd ef "gh ij kl mn op qr st uv wx'
+run_edit_test -s "$doc" -e '29,3,' -e '+3,0,yy ' -x 'ab yy cd ef "gh ij" kl mn op qr uv wx'
+run_edit_test -s "$doc" -e $'25,1,\n' -x $'ab cd ef "gh ij" kl mn op\nqr st uv wx'
+
+#############################
+# snapshot() and restore() with readChunk(), in chunks of 1 to 4 bytes and in lines
+# with snapshots inside tokens, strings, nested comments and UTF-8 sequences
+grammar='
+%class Snap;
+
+start := items;
+items := items item;
+items := item;
+item := ID;
+item := STR;
+
+ID := "[a-z]+";
+STR := "\"[^\"]*\"";
+ENTER_MLCOMMENT := "/\*"! [ML_COMMENT_MODE];
+WS := "\s"!;
+
+%lexer_mode ML_COMMENT_MODE;
+ENTER_MLCOMMENT := "/\*"! [ML_COMMENT_MODE];
+LEAVE_MLCOMMENT := "\*/"! [^];
+CMT := ".*"!;
+'
+
+compile_snapshot_driver "$grammar"
+run_snapshot_test -s $'ab cd\nef gh ij\nkl\n'
+run_snapshot_test -s $'ab "cd\nef" gh\nij /* kl\nmn */ op\nqr'
+run_snapshot_test -s $'ab "é日本" cd\nef /* é /* 日本 */\n本 */ gh "é\né"\n'
+run_snapshot_test -s $'ab cd\nef "gh\nij'
+run_snapshot_test -s $'ab cd\nef gh AB\nij\n'
+
 #############################
 # this infinite loop
 grammar='